@@ -0,0 +1,56 @@
+#include "gesture.h"
+
+#include <stdlib.h>
+
+const char* const GESTURE_NAMES[] = { "none", "tripleBlip", "tripleBrakeBlip", "brakeHold" };
+
+Gesture updateGesture(GestureState& g, int throttle, uint32_t nowMs) {
+  Gesture result = GESTURE_NONE;
+  
+  if (throttle <= GESTURE_HOLD_LEVEL) {
+    if (!g.holding) {
+      g.holding = true;
+      g.holdStart = nowMs;
+      g.holdFired = false;
+    } else if (!g.holdFired && nowMs - g.holdStart >= GESTURE_HOLD_MS) {
+      g.holdFired = true;
+      result = GESTURE_BRAKE_HOLD;
+    }
+  } else {
+    g.holding = false;
+  }
+  
+  bool neutral = abs(throttle) <= GESTURE_NEUTRAL_BAND;
+  if (neutral && !g.atNeutral) {
+    // Back at neutral: the excursion was a blip if it was short and went one way
+    g.atNeutral = true;
+    g.neutralSince = nowMs;
+    bool blip = (g.excursionDir == 1 || g.excursionDir == -1) && nowMs - g.excursionStart <= GESTURE_BLIP_MAX_MS;
+    if (blip && g.blipCount > 0 && g.excursionDir == g.blipDir) {
+      g.blipCount++;
+    } else if (blip && g.excursionSettled) {
+      g.blipDir = g.excursionDir;
+      g.blipCount = 1;
+    } else {
+      g.blipCount = 0;
+    }
+    if (g.blipCount == 3) {
+      result = g.blipDir > 0 ? GESTURE_TRIPLE_BLIP : GESTURE_TRIPLE_BRAKE_BLIP;
+      g.blipCount = 0;
+    }
+  } else if (!neutral && g.atNeutral) {
+    // Leaving neutral: a run of blips only continues after a short gap
+    g.atNeutral = false;
+    uint32_t neutralFor = nowMs - g.neutralSince;
+    g.excursionSettled = neutralFor >= GESTURE_SETTLE_MS;
+    if (neutralFor > GESTURE_BLIP_GAP_MS) g.blipCount = 0;
+    g.excursionStart = nowMs;
+    g.excursionDir = 0;
+  }
+  
+  if (!neutral) {
+    int8_t dir = throttle >= GESTURE_BLIP_LEVEL ? 1 : (throttle <= -GESTURE_BLIP_LEVEL ? -1 : 0);
+    if (dir != 0 && g.excursionDir != dir) g.excursionDir = g.excursionDir == 0 ? dir : 2;
+  }
+  return result;
+}
@@ -0,0 +1,37 @@
+// Stick gesture recogniser: commands from the throttle stick while parked, no phone or
+// Wi-Fi needed. One call per receiver pulse, constant time and memory, and no Arduino
+// calls, so tools/gesture_trace_test.cpp runs it on the host.
+//   triple blip       - three short throttle blips from a settled neutral
+//   triple brake blip - the same on the brake side
+//   brake hold        - full brake held for 3 s (fires once per hold)
+#pragma once
+
+#include <stdint.h>
+
+#define GESTURE_NEUTRAL_BAND 15          // |throttle| at or below this counts as neutral
+#define GESTURE_BLIP_LEVEL 60            // A blip reaches this far to one side of neutral...
+#define GESTURE_BLIP_MAX_MS 400          // ...and is back at neutral within this long
+#define GESTURE_BLIP_GAP_MS 600          // Longest neutral gap between blips of one gesture
+#define GESTURE_SETTLE_MS 1000           // Neutral this long before the first blip (not while driving)
+#define GESTURE_HOLD_LEVEL -95           // Full brake...
+#define GESTURE_HOLD_MS 3000             // ...held this long
+
+enum Gesture : uint8_t { GESTURE_NONE, GESTURE_TRIPLE_BLIP, GESTURE_TRIPLE_BRAKE_BLIP, GESTURE_BRAKE_HOLD };
+extern const char* const GESTURE_NAMES[];
+
+// Recogniser state: fixed size, no sample history (zero-initialise to start)
+struct GestureState {
+  bool atNeutral;
+  uint32_t neutralSince;                 // Start of the current neutral stretch
+  uint32_t excursionStart;               // Left neutral at
+  bool excursionSettled;                 // Neutral for GESTURE_SETTLE_MS before this excursion
+  int8_t excursionDir;                   // 0 = below blip level, +1/-1 = reached one side, 2 = both
+  int8_t blipDir;
+  uint8_t blipCount;                     // Blips so far in the current run
+  bool holding;
+  uint32_t holdStart;
+  bool holdFired;
+};
+
+// Throttle in -100..100; returns the gesture completed by this sample, if any
+Gesture updateGesture(GestureState& g, int throttle, uint32_t nowMs);
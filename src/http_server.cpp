@@ -0,0 +1,768 @@
+#include "http_server.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0
+#endif
+
+static uint32_t httpMillis() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000 + ts.tv_nsec / 1000000);
+}
+
+static uint32_t httpMicros() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+}
+
+static bool wouldBlock() {
+  return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR;
+}
+
+static void setNonBlocking(int fd) {
+  fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+}
+
+static const char* reasonPhrase(int code) {
+  switch (code) {
+    case 200: return "OK";
+    case 204: return "No Content";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 408: return "Request Timeout";
+    case 411: return "Length Required";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+  }
+}
+
+// In place: '+' to space and %XX escapes (the result is never longer)
+static void urlDecode(char* s) {
+  char* out = s;
+  for (; *s; s++) {
+    if (*s == '+') {
+      *out++ = ' ';
+    } else if (*s == '%' && s[1] && s[2]) {
+      char hex[3] = { s[1], s[2], '\0' };
+      *out++ = (char)strtol(hex, nullptr, 16);
+      s += 2;
+    } else {
+      *out++ = *s;
+    }
+  }
+  *out = '\0';
+}
+
+// Non-destructive lookup in a raw header block (used before the block is split up)
+static const char* findHeader(const char* start, const char* end, const char* name) {
+  size_t nameLength = strlen(name);
+  for (const char* line = start; line < end; ) {
+    const char* eol = strstr(line, "\r\n");
+    if (eol == nullptr || eol > end) eol = end;
+    if ((size_t)(eol - line) > nameLength && line[nameLength] == ':' && strncasecmp(line, name, nameLength) == 0) {
+      const char* value = line + nameLength + 1;
+      while (*value == ' ' || *value == '\t') value++;
+      return value;
+    }
+    line = eol + 2;
+  }
+  return nullptr;
+}
+
+HttpServer::HttpServer(uint16_t port)
+  : port(port), listenFd(-1), listenWanted(false), routeCount(0), notFoundHandler(nullptr),
+    requestHook(nullptr), waitHook(nullptr), collectedCount(0), counters(), current(nullptr), reqBody("") {
+  for (Connection& c : conns) {
+    c.fd = -1;
+    c.state = CONN_FREE;
+  }
+}
+
+void HttpServer::on(const char* path, HttpHandler handler) {
+  on(path, HTTP_METHOD_ANY, handler);
+}
+
+void HttpServer::on(const char* path, HttpMethod method, HttpHandler handler) {
+  if (routeCount >= HTTP_MAX_ROUTES) return;
+  routes[routeCount++] = { path, method, handler };
+}
+
+void HttpServer::onNotFound(HttpHandler handler) {
+  notFoundHandler = handler;
+}
+
+void HttpServer::onRequest(HttpHandler hook) {
+  requestHook = hook;
+}
+
+void HttpServer::onWait(HttpHandler hook) {
+  waitHook = hook;
+}
+
+void HttpServer::collectHeaders(const char* const* names, size_t count) {
+  collectedCount = 0;
+  for (size_t i = 0; i < count && collectedCount < HTTP_MAX_COLLECTED_HEADERS; i++) {
+    collected[collectedCount++] = names[i];
+  }
+}
+
+void HttpServer::begin() {
+  listenWanted.store(true);
+}
+
+void HttpServer::stop() {
+  listenWanted.store(false);
+}
+
+void HttpServer::resetStats() {
+  uint8_t active = counters.active;
+  uint8_t streams = counters.eventStreams;
+  memset(&counters, 0, sizeof(counters));
+  counters.active = active;
+  counters.peakActive = active;
+  counters.eventStreams = streams;
+}
+
+///////////////////////
+// EVENT LOOP
+///////////////////////
+
+void HttpServer::poll(uint32_t timeoutMs) {
+  bool wanted = listenWanted.load();
+  if (wanted && listenFd < 0) openListener();
+  if (!wanted && listenFd >= 0) closeAll();
+
+  fd_set readSet, writeSet;
+  FD_ZERO(&readSet);
+  FD_ZERO(&writeSet);
+  int maxFd = -1;
+
+  // With every slot busy, new clients wait in the backlog unless an idle one can make room
+  if (listenFd >= 0 && (counters.active < HTTP_MAX_CLIENTS || evictionCandidate() != nullptr)) {
+    FD_SET(listenFd, &readSet);
+    maxFd = listenFd;
+  }
+  for (Connection& c : conns) {
+    if (c.state == CONN_FREE) continue;
+    FD_SET(c.fd, c.state == CONN_WRITING ? &writeSet : &readSet);
+    if (c.fd > maxFd) maxFd = c.fd;
+  }
+
+  if (maxFd < 0) {
+    usleep(timeoutMs * 1000);
+    return;
+  }
+
+  struct timeval tv;
+  tv.tv_sec = timeoutMs / 1000;
+  tv.tv_usec = (timeoutMs % 1000) * 1000;
+  int ready = select(maxFd + 1, &readSet, &writeSet, nullptr, &tv);
+  uint32_t now = httpMillis();
+
+  if (ready > 0) {
+    // Service existing clients before accepting, so a recycled descriptor number
+    // is never mistaken for one select() reported
+    for (Connection& c : conns) {
+      if (c.state == CONN_READING && FD_ISSET(c.fd, &readSet)) {
+        readClient(c, now);
+      } else if (c.state == CONN_STREAMING && FD_ISSET(c.fd, &readSet)) {
+        drainStream(c);
+      } else if (c.state == CONN_WRITING && FD_ISSET(c.fd, &writeSet)) {
+        writeClient(c, now);
+        while (c.state == CONN_READING && c.rxLength > 0 && processRequest(c, now)) {}
+      }
+    }
+    if (listenFd >= 0 && FD_ISSET(listenFd, &readSet)) acceptClient(now);
+  }
+
+  for (Connection& c : conns) {
+    if (c.state == CONN_FREE) continue;
+    if (c.state == CONN_WRITING && now - c.lastActivityMs > HTTP_WRITE_TIMEOUT_MS) {
+      counters.timeouts++;
+      closeConnection(c);
+    } else if (c.state == CONN_READING && c.rxLength > 0 && now - c.requestStartMs > HTTP_REQUEST_TIMEOUT_MS) {
+      counters.timeouts++;
+      sendError(c, 408, now);
+    } else if (c.state == CONN_READING && c.rxLength == 0 && now - c.lastActivityMs > HTTP_IDLE_TIMEOUT_MS) {
+      closeConnection(c);
+    }
+  }
+}
+
+void HttpServer::openListener() {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (fd < 0) return;
+
+  int yes = 1;
+  setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(port);
+  addr.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, HTTP_MAX_CLIENTS) < 0) {
+    ::close(fd);                         // Retried on the next poll
+    return;
+  }
+  setNonBlocking(fd);
+  listenFd = fd;
+}
+
+void HttpServer::closeAll() {
+  for (Connection& c : conns) {
+    if (c.state != CONN_FREE) closeConnection(c);
+  }
+  ::close(listenFd);
+  listenFd = -1;
+}
+
+// Longest-idle connection with no request in progress (browsers hold spare ones open)
+HttpServer::Connection* HttpServer::evictionCandidate() {
+  Connection* oldest = nullptr;
+  for (Connection& c : conns) {
+    if (c.state != CONN_READING || c.rxLength > 0) continue;
+    if (oldest == nullptr || (int32_t)(c.lastActivityMs - oldest->lastActivityMs) < 0) oldest = &c;
+  }
+  return oldest;
+}
+
+void HttpServer::acceptClient(uint32_t now) {
+  struct sockaddr_in addr;
+  socklen_t addrLength = sizeof(addr);
+  int fd = accept(listenFd, (struct sockaddr*)&addr, &addrLength);
+  if (fd < 0) return;
+
+  Connection* slot = nullptr;
+  for (Connection& c : conns) {
+    if (c.state == CONN_FREE) {
+      slot = &c;
+      break;
+    }
+  }
+  if (slot == nullptr) {
+    slot = evictionCandidate();
+    if (slot == nullptr) {
+      ::close(fd);
+      return;
+    }
+    closeConnection(*slot);
+    counters.evicted++;
+  }
+
+  setNonBlocking(fd);
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  Connection& c = *slot;
+  c.fd = fd;
+  c.state = CONN_READING;
+  c.keepAlive = true;
+  c.eventStream = false;
+  c.lastActivityMs = now;
+  c.requestStartMs = now;
+  c.requestsServed = 0;
+  c.rxLength = 0;
+  c.txLength = c.txSent = 0;
+  c.extBody = nullptr;
+  c.extLength = c.extSent = 0;
+  counters.accepted++;
+  counters.active++;
+  if (counters.active > counters.peakActive) counters.peakActive = counters.active;
+}
+
+void HttpServer::closeConnection(Connection& c) {
+  ::close(c.fd);
+  c.fd = -1;
+  c.state = CONN_FREE;
+  counters.active--;
+  if (c.eventStream) counters.eventStreams--;
+  c.eventStream = false;
+}
+
+void HttpServer::readClient(Connection& c, uint32_t now) {
+  ssize_t n = recv(c.fd, c.rx + c.rxLength, HTTP_RX_BUFFER - c.rxLength, 0);
+  if (n == 0 || (n < 0 && !wouldBlock())) {
+    closeConnection(c);                  // Peer closed or reset
+    return;
+  }
+  if (n < 0) return;
+
+  if (c.rxLength == 0) c.requestStartMs = now;
+  c.rxLength += n;
+  c.lastActivityMs = now;
+  counters.bytesIn += n;
+
+  // Pipelined requests are answered one at a time, each once the previous response is out
+  while (c.state == CONN_READING && c.rxLength > 0 && processRequest(c, now)) {}
+}
+
+// Event streams only ever receive: anything the client sends is discarded, and a read
+// of 0 is the browser closing the page
+void HttpServer::drainStream(Connection& c) {
+  ssize_t n = recv(c.fd, c.rx, HTTP_RX_BUFFER, 0);
+  if (n == 0 || (n < 0 && !wouldBlock())) closeConnection(c);
+}
+
+///////////////////////
+// REQUEST PARSING
+///////////////////////
+
+// Parses and answers one complete request at the front of the buffer. Returns true if a
+// response went out in full and the connection is ready for the next request.
+bool HttpServer::processRequest(Connection& c, uint32_t now) {
+  c.rx[c.rxLength] = '\0';
+  char* headerEnd = strstr(c.rx, "\r\n\r\n");
+  if (headerEnd == nullptr) {
+    if (c.rxLength >= HTTP_RX_BUFFER) sendError(c, 431, now);
+    return false;
+  }
+  size_t headerLength = headerEnd + 4 - c.rx;
+
+  // Completeness first: the block is split up in place below
+  if (findHeader(c.rx, headerEnd, "Transfer-Encoding")) {
+    sendError(c, 411, now);
+    return false;
+  }
+  const char* lengthValue = findHeader(c.rx, headerEnd, "Content-Length");
+  size_t contentLength = lengthValue ? strtoul(lengthValue, nullptr, 10) : 0;
+  if (contentLength > HTTP_RX_BUFFER - headerLength) {
+    sendError(c, 413, now);
+    return false;
+  }
+  if (c.rxLength < headerLength + contentLength) return false;  // Body still arriving
+
+  // Request line: METHOD SP target SP version
+  char* lineEnd = strstr(c.rx, "\r\n");
+  *lineEnd = '\0';
+  char* target = strchr(c.rx, ' ');
+  char* version = target ? strchr(target + 1, ' ') : nullptr;
+  if (version == nullptr) {
+    sendError(c, 400, now);
+    return false;
+  }
+  *target++ = '\0';
+  *version++ = '\0';
+  reqMethod = strcmp(c.rx, "GET") == 0 ? HTTP_METHOD_GET : (strcmp(c.rx, "POST") == 0 ? HTTP_METHOD_POST : HTTP_METHOD_OTHER);
+  c.http11 = strcmp(version, "HTTP/1.1") == 0;
+  c.keepAlive = c.http11;
+
+  // Headers: Connection, Content-Type and the collected ones
+  bool formBody = false;
+  for (uint8_t i = 0; i < collectedCount; i++) headerValues[i] = "";
+  for (char* line = lineEnd + 2; line < headerEnd; ) {
+    char* eol = strstr(line, "\r\n");
+    *eol = '\0';
+    char* colon = strchr(line, ':');
+    if (colon != nullptr) {
+      *colon = '\0';
+      char* value = colon + 1;
+      while (*value == ' ' || *value == '\t') value++;
+      if (strcasecmp(line, "Connection") == 0) {
+        if (strcasecmp(value, "close") == 0) c.keepAlive = false;
+        else if (strcasecmp(value, "keep-alive") == 0) c.keepAlive = true;
+      } else if (strcasecmp(line, "Content-Type") == 0) {
+        formBody = strncasecmp(value, "application/x-www-form-urlencoded", 33) == 0;
+      }
+      for (uint8_t i = 0; i < collectedCount; i++) {
+        if (strcasecmp(line, collected[i]) == 0) headerValues[i] = value;
+      }
+    }
+    line = eol + 2;
+  }
+
+  // Body (NUL-terminated in place, the byte it covers restored afterwards) and arguments
+  char* body = c.rx + headerLength;
+  char covered = body[contentLength];
+  body[contentLength] = '\0';
+  reqBody = body;
+  argCount = 0;
+  char* query = strchr(target, '?');
+  if (query != nullptr) {
+    *query++ = '\0';
+    parseArgs(query);
+  }
+  if (formBody && reqMethod == HTTP_METHOD_POST) {
+    parseArgs(body);
+    reqBody = "";
+  }
+  reqUri = target;
+
+  current = &c;
+  responded = false;
+  extraHeadersLength = 0;
+  c.chunked = false;
+  c.txLength = c.txSent = 0;
+  c.extBody = nullptr;
+  c.extLength = c.extSent = 0;
+
+  uint32_t start = httpMicros();
+  dispatch();
+  if (!responded) send(500, "text/plain", "No response");
+  uint32_t elapsed = httpMicros() - start;
+  current = nullptr;
+
+  counters.requests++;
+  counters.handlerUsTotal += elapsed;
+  if (elapsed > counters.handlerUsMax) counters.handlerUsMax = elapsed;
+  if (c.requestsServed++ > 0) counters.keepAliveReuses++;
+
+  // Drop the request; a pipelined one may follow it in the buffer
+  body[contentLength] = covered;
+  size_t consumed = headerLength + contentLength;
+  memmove(c.rx, c.rx + consumed, c.rxLength - consumed);
+  c.rxLength -= consumed;
+  c.requestStartMs = now;
+
+  writeClient(c, now);
+  return c.state == CONN_READING;
+}
+
+void HttpServer::parseArgs(char* s) {
+  while (s != nullptr && *s != '\0' && argCount < HTTP_MAX_ARGS) {
+    char* next = strchr(s, '&');
+    if (next != nullptr) *next++ = '\0';
+    char* equals = strchr(s, '=');
+    const char* value = "";
+    if (equals != nullptr) {
+      *equals = '\0';
+      urlDecode(equals + 1);
+      value = equals + 1;
+    }
+    urlDecode(s);
+    args[argCount++] = { s, value };
+    s = next;
+  }
+}
+
+void HttpServer::dispatch() {
+  if (requestHook) requestHook();
+  for (uint8_t i = 0; i < routeCount; i++) {
+    const Route& route = routes[i];
+    if (strcmp(route.path, reqUri) == 0 && (route.method == HTTP_METHOD_ANY || route.method == reqMethod)) {
+      route.handler();
+      return;
+    }
+  }
+  if (notFoundHandler) {
+    notFoundHandler();
+  } else {
+    send_P(404, "text/plain", "Not found");
+  }
+}
+
+///////////////////////
+// HANDLER API
+///////////////////////
+
+HttpMethod HttpServer::method() const {
+  return reqMethod;
+}
+
+const char* HttpServer::uri() const {
+  return reqUri;
+}
+
+bool HttpServer::hasArg(const char* name) const {
+  if (strcmp(name, "plain") == 0) return reqBody[0] != '\0';
+  for (uint8_t i = 0; i < argCount; i++) {
+    if (strcmp(args[i].name, name) == 0) return true;
+  }
+  return false;
+}
+
+const char* HttpServer::arg(const char* name) const {
+  if (strcmp(name, "plain") == 0) return reqBody;
+  for (uint8_t i = 0; i < argCount; i++) {
+    if (strcmp(args[i].name, name) == 0) return args[i].value;
+  }
+  return "";
+}
+
+const char* HttpServer::header(const char* name) const {
+  for (uint8_t i = 0; i < collectedCount; i++) {
+    if (strcasecmp(collected[i], name) == 0) return headerValues[i];
+  }
+  return "";
+}
+
+void HttpServer::sendHeader(const char* name, const char* value) {
+  int n = snprintf(extraHeaders + extraHeadersLength, HTTP_HEADER_BUFFER - extraHeadersLength, "%s: %s\r\n", name, value);
+  if (n > 0 && extraHeadersLength + n < HTTP_HEADER_BUFFER) extraHeadersLength += n;
+  else extraHeaders[extraHeadersLength] = '\0';  // Dropped: no room
+}
+
+// Status line and headers (with a negative length: chunked). Needs HTTP_HEADER_RESERVE
+// bytes at most: the fixed part is under 180 and the handler's extra headers are capped.
+size_t HttpServer::formatHead(char* out, int code, const char* contentType, long length) {
+  int n = snprintf(out, HTTP_HEADER_RESERVE, "HTTP/1.1 %d %s\r\nConnection: %s\r\n",
+                   code, reasonPhrase(code), current->keepAlive ? "keep-alive" : "close");
+  if (length < 0) {
+    n += snprintf(out + n, HTTP_HEADER_RESERVE - n, "Transfer-Encoding: chunked\r\n");
+  } else if (code != 204 && code != 304) {
+    n += snprintf(out + n, HTTP_HEADER_RESERVE - n, "Content-Length: %u\r\n", (unsigned)length);
+  }
+  if (contentType != nullptr) {
+    n += snprintf(out + n, HTTP_HEADER_RESERVE - n, "Content-Type: %.64s\r\n", contentType);
+  }
+  memcpy(out + n, extraHeaders, extraHeadersLength);
+  n += extraHeadersLength;
+  memcpy(out + n, "\r\n", 2);
+  return n + 2;
+}
+
+// Status line and headers into the connection's response buffer
+bool HttpServer::beginResponse(int code, const char* contentType, size_t length) {
+  if (current == nullptr || responded) return false;
+  responded = true;
+  current->txLength = formatHead(current->tx, code, contentType, length);
+  return true;
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body) {
+  send(code, contentType, body, body ? strlen(body) : 0);
+}
+
+void HttpServer::send(int code, const char* contentType, const char* body, size_t length) {
+  if (!beginResponse(code, contentType, length)) return;
+  if (current->txLength + length > HTTP_TX_BUFFER) {
+    responded = false;
+    send_P(500, "text/plain", "Response too large");
+    return;
+  }
+  memcpy(current->tx + current->txLength, body, length);
+  current->txLength += length;
+}
+
+void HttpServer::send_P(int code, const char* contentType, const char* body) {
+  send_P(code, contentType, body, strlen(body));
+}
+
+void HttpServer::send_P(int code, const char* contentType, const char* body, size_t length) {
+  if (!beginResponse(code, contentType, length)) return;
+  current->extBody = body;
+  current->extLength = length;
+}
+
+///////////////////////
+// IN-PLACE BODIES
+///////////////////////
+
+// The body sits at tx + HTTP_HEADER_RESERVE; headers (and chunk size lines) are written
+// backwards from there once known, so the bytes on the wire are contiguous from txSent
+char* HttpServer::beginBody(int code, const char* contentType, size_t* capacity) {
+  if (current == nullptr || responded) return nullptr;
+  responded = true;
+  bodyCode = code;
+  bodyType = contentType;
+  current->chunked = false;
+  *capacity = HTTP_TX_BUFFER - HTTP_HEADER_RESERVE - HTTP_CHUNK_TRAILER;
+  return current->tx + HTTP_HEADER_RESERVE;
+}
+
+bool HttpServer::flushBody(size_t length) {
+  if (current == nullptr || !responded || current->txLength > 0 || !current->http11) return false;
+  Connection& c = *current;
+
+  char sizeLine[12];
+  size_t start = HTTP_HEADER_RESERVE - snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)length);
+  memcpy(c.tx + start, sizeLine, HTTP_HEADER_RESERVE - start);
+  if (!c.chunked) {
+    char head[HTTP_HEADER_RESERVE];
+    size_t n = formatHead(head, bodyCode, bodyType, -1);
+    start -= n;
+    memcpy(c.tx + start, head, n);
+    c.chunked = true;
+    counters.chunked++;
+  }
+  memcpy(c.tx + HTTP_HEADER_RESERVE + length, "\r\n", 2);
+  c.txSent = start;
+  c.txLength = HTTP_HEADER_RESERVE + length + 2;
+
+  // Out before returning: the handler reuses the buffer for the next chunk. The send
+  // buffer (about 5.7 KB on lwIP) fills before the client ACKs, so wait for it to drain,
+  // for up to the write timeout per chunk
+  uint32_t flushStart = httpMillis();
+  while (c.txSent < c.txLength) {
+    ssize_t n = ::send(c.fd, c.tx + c.txSent, c.txLength - c.txSent, MSG_NOSIGNAL);
+    if (n >= 0) {
+      c.txSent += n;
+      counters.bytesOut += n;
+      continue;
+    }
+    uint32_t waited = httpMillis() - flushStart;
+    if (!wouldBlock() || waited >= HTTP_WRITE_TIMEOUT_MS) break;
+    fd_set writeSet;
+    FD_ZERO(&writeSet);
+    FD_SET(c.fd, &writeSet);
+    uint32_t remaining = HTTP_WRITE_TIMEOUT_MS - waited;
+    if (remaining > HTTP_WAIT_SLICE_MS) remaining = HTTP_WAIT_SLICE_MS;
+    struct timeval tv;
+    tv.tv_sec = remaining / 1000;
+    tv.tv_usec = (remaining % 1000) * 1000;
+    if (select(c.fd + 1, nullptr, &writeSet, nullptr, &tv) < 0 && errno != EINTR) break;
+    if (waitHook) waitHook();
+  }
+  if (c.txSent < c.txLength) {
+    // Client not reading: what is queued still goes out, then the connection closes
+    // without the last chunk, so the client sees an incomplete response
+    c.keepAlive = false;
+    counters.truncated++;
+    return false;
+  }
+  c.txLength = c.txSent = 0;
+  return true;
+}
+
+void HttpServer::endBody(size_t length, bool complete) {
+  if (current == nullptr || !responded) return;
+  Connection& c = *current;
+
+  if (!c.chunked) {
+    if (!complete) {
+      responded = false;
+      send_P(500, "text/plain", "Response too large");
+      return;
+    }
+    char head[HTTP_HEADER_RESERVE];
+    size_t n = formatHead(head, bodyCode, bodyType, length);
+    c.txSent = HTTP_HEADER_RESERVE - n;
+    memcpy(c.tx + c.txSent, head, n);
+    c.txLength = HTTP_HEADER_RESERVE + length;
+    return;
+  }
+  if (c.txLength > 0 || !complete) {
+    c.keepAlive = false;                 // A flush failed: no last chunk, close once sent
+    return;
+  }
+
+  // Final chunk (if any) and the zero-length chunk that ends the body
+  size_t start = HTTP_HEADER_RESERVE;
+  size_t end = HTTP_HEADER_RESERVE;
+  if (length > 0) {
+    char sizeLine[12];
+    start -= snprintf(sizeLine, sizeof(sizeLine), "%x\r\n", (unsigned)length);
+    memcpy(c.tx + start, sizeLine, HTTP_HEADER_RESERVE - start);
+    memcpy(c.tx + HTTP_HEADER_RESERVE + length, "\r\n", 2);
+    end += length + 2;
+  }
+  memcpy(c.tx + end, "0\r\n\r\n", 5);
+  c.txSent = start;
+  c.txLength = end + 5;
+}
+
+///////////////////////
+// EVENT STREAMS
+///////////////////////
+
+// No Content-Length: the response runs until either side closes the connection
+bool HttpServer::beginEventStream() {
+  if (current == nullptr || responded || counters.eventStreams >= HTTP_MAX_EVENT_STREAMS) return false;
+  responded = true;
+
+  int n = snprintf(current->tx, HTTP_TX_BUFFER,
+                   "HTTP/1.1 200 OK\r\nContent-Type: text/event-stream\r\nCache-Control: no-cache\r\n"
+                   "Connection: keep-alive\r\n%.*s\r\nretry: %d\n\n",
+                   (int)extraHeadersLength, extraHeaders, HTTP_EVENT_RETRY_MS);
+  current->txLength = n;
+  current->eventStream = true;
+  counters.eventStreams++;
+  return true;
+}
+
+uint8_t HttpServer::broadcastEvent(const char* data, size_t length) {
+  if (length + 8 > HTTP_TX_BUFFER) return 0;
+  uint32_t now = httpMillis();
+  uint8_t queued = 0;
+  for (Connection& c : conns) {
+    if (!c.eventStream) continue;
+    if (c.state != CONN_STREAMING) {
+      counters.eventsDropped++;          // Still writing an earlier event
+      continue;
+    }
+    memcpy(c.tx, "data: ", 6);
+    memcpy(c.tx + 6, data, length);
+    memcpy(c.tx + 6 + length, "\n\n", 2);
+    c.txLength = length + 8;
+    c.txSent = 0;
+    counters.eventsSent++;
+    queued++;
+    writeClient(c, now);
+  }
+  return queued;
+}
+
+///////////////////////
+// RESPONSE OUTPUT
+///////////////////////
+
+// Writes as much of the response as the socket takes without blocking
+void HttpServer::writeClient(Connection& c, uint32_t now) {
+  c.state = CONN_WRITING;
+  while (c.txSent < c.txLength || c.extSent < c.extLength) {
+    bool headerPart = c.txSent < c.txLength;
+    const char* data = headerPart ? c.tx + c.txSent : c.extBody + c.extSent;
+    size_t length = headerPart ? c.txLength - c.txSent : c.extLength - c.extSent;
+    ssize_t n = ::send(c.fd, data, length, MSG_NOSIGNAL);
+    if (n < 0) {
+      if (!wouldBlock()) closeConnection(c);
+      return;                            // Socket full: select() says when to resume
+    }
+    if (headerPart) c.txSent += n;
+    else c.extSent += n;
+    c.lastActivityMs = now;
+    counters.bytesOut += n;
+  }
+  responseDone(c, now);
+}
+
+void HttpServer::responseDone(Connection& c, uint32_t now) {
+  c.txLength = c.txSent = 0;
+  c.extBody = nullptr;
+  c.extLength = c.extSent = 0;
+  if (c.eventStream) {
+    c.state = CONN_STREAMING;            // Requests pipelined behind the stream are ignored
+    c.rxLength = 0;
+    c.lastActivityMs = now;
+    return;
+  }
+  if (!c.keepAlive) {
+    closeConnection(c);
+    return;
+  }
+  c.state = CONN_READING;
+  c.lastActivityMs = now;
+}
+
+// Answer from the server itself (malformed, oversized or timed-out request), then close
+void HttpServer::sendError(Connection& c, int code, uint32_t now) {
+  counters.rejected++;
+  c.keepAlive = false;
+  c.rxLength = 0;
+  current = &c;
+  responded = false;
+  extraHeadersLength = 0;
+  c.txLength = c.txSent = 0;
+  c.extBody = nullptr;
+  c.extLength = c.extSent = 0;
+  send_P(code, "text/plain", reasonPhrase(code));
+  current = nullptr;
+  writeClient(c, now);
+}
@@ -0,0 +1,190 @@
+// Event-driven HTTP/1.1 server on BSD sockets (lwIP on the ESP32, the host's own
+// sockets for the load test in tools/). One task calls poll(); select() multiplexes
+// the listener and every connection, and no socket call ever blocks, so a slow or
+// stalled client only ever holds its own connection slot.
+//
+// Memory is fixed: HTTP_MAX_CLIENTS connection slots, each with a request buffer and
+// a response buffer. Requests are parsed in place (arguments and headers point into
+// the request buffer), so a request costs no heap at all.
+//
+// A handler can also write its body in place with beginBody()/endBody() instead of
+// handing over a finished one: the headers go into room reserved ahead of the body, so
+// nothing is copied. A body that outgrows the buffer goes out as chunks (flushBody()),
+// the one place the server waits on a client.
+//
+// A handler can turn its connection into a Server-Sent Events stream; the server task
+// then pushes one event to every stream with broadcastEvent(). A stream still sending
+// the previous event skips the new one, so a slow client only ever falls behind itself.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#ifndef HTTP_MAX_CLIENTS
+#define HTTP_MAX_CLIENTS 4               // lwIP has 10 sockets in total (OTA and WiFi need some)
+#endif
+#define HTTP_RX_BUFFER 1024              // Request line, headers and body of one request
+#define HTTP_TX_BUFFER 4608              // Response headers plus a copied body (API JSON is <= 4 KB)
+#define HTTP_HEADER_BUFFER 256           // Extra response headers set by the handler
+#define HTTP_HEADER_RESERVE 448          // Room ahead of an in-place body: headers and a chunk size
+#define HTTP_CHUNK_TRAILER 7             // Room after it: CRLF ending the chunk and the last chunk
+#define HTTP_MAX_ARGS 8
+#define HTTP_MAX_ROUTES 48
+#define HTTP_MAX_COLLECTED_HEADERS 4
+#define HTTP_MAX_EVENT_STREAMS (HTTP_MAX_CLIENTS - 1)  // One slot always left for requests
+#define HTTP_EVENT_RETRY_MS 2000         // Browser reconnect delay after a dropped stream
+#define HTTP_REQUEST_TIMEOUT_MS 3000     // A started request must be complete by then
+#define HTTP_IDLE_TIMEOUT_MS 10000       // Keep-alive connection with no request
+#define HTTP_WRITE_TIMEOUT_MS 5000       // Client not reading its response
+#define HTTP_WAIT_SLICE_MS 500           // flushBody() calls the wait hook at least this often
+
+enum HttpMethod : uint8_t { HTTP_METHOD_ANY, HTTP_METHOD_GET, HTTP_METHOD_POST, HTTP_METHOD_OTHER };
+
+typedef void (*HttpHandler)();
+
+struct HttpStats {
+  uint32_t accepted;                     // Connections accepted
+  uint32_t requests;                     // Requests answered
+  uint32_t keepAliveReuses;              // Requests on an already used connection
+  uint32_t evicted;                      // Idle keep-alive connections closed to admit a new one
+  uint32_t timeouts;                     // Connections dropped for a slow request or response
+  uint32_t rejected;                     // Requests answered 4xx by the server itself (malformed, too large)
+  uint32_t bytesIn;
+  uint32_t bytesOut;
+  uint8_t active;                        // Open connections now
+  uint8_t peakActive;
+  uint8_t eventStreams;                  // Open event streams now
+  uint32_t eventsSent;                   // Events queued to a stream
+  uint32_t eventsDropped;                // Events skipped by a stream still sending the last one
+  uint32_t chunked;                      // In-place bodies too big for the buffer, sent in chunks
+  uint32_t truncated;                    // Chunked bodies cut short: the client was not reading
+  uint32_t handlerUsTotal;               // Time inside handlers
+  uint32_t handlerUsMax;
+};
+
+class HttpServer {
+public:
+  explicit HttpServer(uint16_t port);
+
+  // Setup, before the first poll()
+  void on(const char* path, HttpHandler handler);
+  void on(const char* path, HttpMethod method, HttpHandler handler);
+  void onNotFound(HttpHandler handler);
+  void onRequest(HttpHandler hook);      // Every request, before routing
+  void onWait(HttpHandler hook);         // While flushBody() waits on a client (e.g. feed a watchdog)
+  void collectHeaders(const char* const* names, size_t count);
+
+  // Any task: open or close the listener (applied by the next poll)
+  void begin();
+  void stop();
+
+  // Server task: wait up to timeoutMs for socket events and service them
+  void poll(uint32_t timeoutMs);
+
+  // Inside a handler
+  HttpMethod method() const;
+  const char* uri() const;
+  bool hasArg(const char* name) const;
+  const char* arg(const char* name) const;      // "" if absent; "plain" is the raw body
+  const char* header(const char* name) const;   // "" unless collected
+  void sendHeader(const char* name, const char* value);
+  void send(int code, const char* contentType = nullptr, const char* body = nullptr);
+  void send(int code, const char* contentType, const char* body, size_t length);       // Body is copied
+  void send_P(int code, const char* contentType, const char* body);
+  void send_P(int code, const char* contentType, const char* body, size_t length);     // Body must outlive the response (flash, literals)
+  bool beginEventStream();               // Instead of send(); false if all stream slots are taken
+
+  // Instead of send(): write the body at the returned pointer (up to *capacity bytes),
+  // then endBody() with its length. When the buffer is full, flushBody() sends what is
+  // there as a chunk and the body starts over at the same pointer. It waits for the
+  // socket to drain (up to HTTP_WRITE_TIMEOUT_MS per chunk, holding up the server task
+  // meanwhile, with the onWait() hook called every HTTP_WAIT_SLICE_MS); false means the
+  // client stopped reading and the response is cut short (the connection then closes).
+  // endBody(length, false) after a failed write answers 500 instead if nothing went out.
+  char* beginBody(int code, const char* contentType, size_t* capacity);
+  bool flushBody(size_t length);
+  void endBody(size_t length, bool complete = true);
+
+  // Server task, between polls: one "data:" event (a single line) to every stream.
+  // Returns the number of streams it was queued to.
+  uint8_t broadcastEvent(const char* data, size_t length);
+  uint8_t eventStreams() const { return counters.eventStreams; }
+
+  const HttpStats& stats() const { return counters; }
+  void resetStats();
+
+private:
+  struct Route {
+    const char* path;
+    HttpMethod method;
+    HttpHandler handler;
+  };
+  struct Arg {
+    const char* name;
+    const char* value;
+  };
+  enum ConnState : uint8_t { CONN_FREE, CONN_READING, CONN_WRITING, CONN_STREAMING };
+  struct Connection {
+    int fd;
+    ConnState state;
+    bool keepAlive;
+    bool http11;                         // Request was HTTP/1.1: chunked bodies allowed
+    bool chunked;                        // In-place body already flushed as chunks
+    bool eventStream;                    // Answered with beginEventStream(); only events follow
+    uint32_t lastActivityMs;
+    uint32_t requestStartMs;             // First byte of the request being received
+    uint32_t requestsServed;
+    size_t rxLength;
+    char rx[HTTP_RX_BUFFER + 1];         // +1: the body is NUL-terminated in place
+    size_t txLength;
+    size_t txSent;
+    const char* extBody;                 // send_P body, written after tx
+    size_t extLength;
+    size_t extSent;
+    char tx[HTTP_TX_BUFFER];
+  };
+
+  uint16_t port;
+  int listenFd;
+  std::atomic<bool> listenWanted;
+  Route routes[HTTP_MAX_ROUTES];
+  uint8_t routeCount;
+  HttpHandler notFoundHandler;
+  HttpHandler requestHook;
+  HttpHandler waitHook;
+  const char* collected[HTTP_MAX_COLLECTED_HEADERS];
+  uint8_t collectedCount;
+  Connection conns[HTTP_MAX_CLIENTS];
+  HttpStats counters;
+
+  // The request being handled (valid during dispatch only)
+  Connection* current;
+  HttpMethod reqMethod;
+  const char* reqUri;
+  const char* reqBody;
+  Arg args[HTTP_MAX_ARGS];
+  uint8_t argCount;
+  const char* headerValues[HTTP_MAX_COLLECTED_HEADERS];
+  char extraHeaders[HTTP_HEADER_BUFFER];
+  size_t extraHeadersLength;
+  bool responded;
+  int bodyCode;                          // beginBody() response, headed once the length is known
+  const char* bodyType;
+
+  void openListener();
+  void closeAll();
+  void acceptClient(uint32_t now);
+  Connection* evictionCandidate();
+  void closeConnection(Connection& c);
+  void readClient(Connection& c, uint32_t now);
+  void drainStream(Connection& c);
+  bool processRequest(Connection& c, uint32_t now);
+  void dispatch();
+  void parseArgs(char* query);
+  size_t formatHead(char* out, int code, const char* contentType, long length);
+  bool beginResponse(int code, const char* contentType, size_t length);
+  void writeClient(Connection& c, uint32_t now);
+  void responseDone(Connection& c, uint32_t now);
+  void sendError(Connection& c, int code, uint32_t now);
+};
@@ -0,0 +1,193 @@
+#include "json_writer.h"
+
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+JsonWriter::JsonWriter(char* buffer, size_t capacity, JsonFlush flush, void* context)
+  : buffer(buffer), capacity(capacity), used(0), flushed(0), flush(flush), context(context),
+    overflow(false), afterKey(false), depth(0), hasItems(0) {}
+
+///////////////////////
+// OUTPUT
+///////////////////////
+
+// Buffer full: hand it to the flush callback and start over at the front
+bool JsonWriter::makeRoom() {
+  if (overflow) return false;
+  if (flush != nullptr && used > 0 && flush(context, used)) {
+    flushed += used;
+    used = 0;
+    return true;
+  }
+  overflow = true;
+  return false;
+}
+
+void JsonWriter::put(char c) {
+  if (used == capacity && !makeRoom()) return;
+  buffer[used++] = c;
+}
+
+void JsonWriter::put(const char* s, size_t n) {
+  while (n > 0) {
+    if (used == capacity && !makeRoom()) return;
+    size_t room = capacity - used;
+    size_t k = n < room ? n : room;
+    memcpy(buffer + used, s, k);
+    used += k;
+    s += k;
+    n -= k;
+  }
+}
+
+void JsonWriter::putUnsigned(unsigned long v) {
+  char digits[20];
+  size_t n = 0;
+  do {
+    digits[n++] = '0' + v % 10;
+    v /= 10;
+  } while (v > 0);
+  while (n > 0) put(digits[--n]);
+}
+
+// Comma before every value but the first at its level (a key's value takes none)
+void JsonWriter::separator() {
+  if (afterKey) {
+    afterKey = false;
+    return;
+  }
+  uint32_t bit = 1u << depth;
+  if (hasItems & bit) put(',');
+  hasItems |= bit;
+}
+
+///////////////////////
+// STRUCTURE
+///////////////////////
+
+JsonWriter& JsonWriter::open(char c) {
+  separator();
+  put(c);
+  if (depth < JSON_MAX_DEPTH) depth++;
+  hasItems &= ~(1u << depth);
+  return *this;
+}
+
+JsonWriter& JsonWriter::close(char c) {
+  if (depth > 0) depth--;
+  put(c);
+  return *this;
+}
+
+JsonWriter& JsonWriter::beginObject() { return open('{'); }
+JsonWriter& JsonWriter::endObject() { return close('}'); }
+JsonWriter& JsonWriter::beginArray() { return open('['); }
+JsonWriter& JsonWriter::endArray() { return close(']'); }
+
+JsonWriter& JsonWriter::key(const char* name) {
+  separator();
+  put('"');
+  put(name, strlen(name));
+  put("\":", 2);
+  afterKey = true;
+  return *this;
+}
+
+///////////////////////
+// VALUES
+///////////////////////
+
+JsonWriter& JsonWriter::value(const char* s) {
+  separator();
+  if (s == nullptr) {
+    put("null", 4);
+    return *this;
+  }
+  put('"');
+  for (; *s; s++) {
+    uint8_t c = *s;
+    if (c == '"' || c == '\\') {
+      put('\\');
+      put(c);
+    } else if (c < 0x20) {
+      static const char HEX[] = "0123456789abcdef";
+      char escape[6] = { '\\', 'u', '0', '0', HEX[c >> 4], HEX[c & 15] };
+      put(escape, sizeof(escape));
+    } else {
+      put(c);
+    }
+  }
+  put('"');
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(bool b) {
+  separator();
+  if (b) put("true", 4);
+  else put("false", 5);
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(int v) { return value((long)v); }
+JsonWriter& JsonWriter::value(unsigned v) { return value((unsigned long)v); }
+
+JsonWriter& JsonWriter::value(long v) {
+  separator();
+  if (v < 0) {
+    put('-');
+    putUnsigned(0UL - (unsigned long)v);
+  } else {
+    putUnsigned(v);
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::value(unsigned long v) {
+  separator();
+  putUnsigned(v);
+  return *this;
+}
+
+// Fixed decimals, rounded half away from zero; integer arithmetic after one scale
+JsonWriter& JsonWriter::value(float v, uint8_t decimals) {
+  separator();
+  if (isnan(v) || isinf(v)) {
+    put("null", 4);
+    return *this;
+  }
+  if (decimals > 6) decimals = 6;
+  uint32_t scale = 1;
+  for (uint8_t i = 0; i < decimals; i++) scale *= 10;
+  if (v < 0) {
+    put('-');
+    v = -v;
+  }
+  uint64_t scaled = (uint64_t)((double)v * scale + 0.5);
+  putUnsigned((unsigned long)(scaled / scale));
+  if (decimals > 0) {
+    put('.');
+    uint32_t fraction = scaled % scale;
+    for (uint32_t digit = scale / 10; digit > 0; digit /= 10) {
+      put('0' + fraction / digit % 10);
+    }
+  }
+  return *this;
+}
+
+JsonWriter& JsonWriter::valuef(const char* format, ...) {
+  char text[48];
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(text, sizeof(text), format, args);
+  va_end(args);
+  if (n < 0) n = 0;
+  if ((size_t)n >= sizeof(text)) n = sizeof(text) - 1;
+
+  separator();
+  put('"');
+  put(text, n);
+  put('"');
+  return *this;
+}
@@ -0,0 +1,63 @@
+// Streaming JSON writer over a fixed buffer. Commas, quoting and escaping are handled by
+// the writer and numbers are formatted without printf, so building a response allocates
+// nothing and parses no format strings.
+//
+// When the buffer fills, the flush callback is handed the bytes written so far and the
+// writer starts again at the front of the buffer (the HTTP server sends them as a chunk).
+// Without a callback, or if it fails, output stops and overflowed() is set.
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define JSON_MAX_DEPTH 31
+
+typedef bool (*JsonFlush)(void* context, size_t length);
+
+class JsonWriter {
+public:
+  JsonWriter(char* buffer, size_t capacity, JsonFlush flush = nullptr, void* context = nullptr);
+
+  JsonWriter& beginObject();
+  JsonWriter& endObject();
+  JsonWriter& beginArray();
+  JsonWriter& endArray();
+  JsonWriter& key(const char* name);     // Written as given: names are literals
+
+  JsonWriter& value(const char* s);      // Escaped; nullptr writes null
+  JsonWriter& value(bool b);
+  JsonWriter& value(int v);
+  JsonWriter& value(unsigned v);
+  JsonWriter& value(long v);
+  JsonWriter& value(unsigned long v);
+  JsonWriter& value(float v, uint8_t decimals = 1);  // NaN and infinity write null
+  JsonWriter& valuef(const char* format, ...);        // Quoted, not escaped (addresses, durations)
+
+  template <typename T>
+  JsonWriter& field(const char* name, T v) { return key(name).value(v); }
+  JsonWriter& field(const char* name, float v, uint8_t decimals) { return key(name).value(v, decimals); }
+
+  size_t length() const { return used; }             // In the buffer now (since the last flush)
+  size_t total() const { return flushed + used; }    // Whole document so far
+  bool overflowed() const { return overflow; }
+
+private:
+  char* buffer;
+  size_t capacity;
+  size_t used;
+  size_t flushed;
+  JsonFlush flush;
+  void* context;
+  bool overflow;
+  bool afterKey;
+  uint8_t depth;
+  uint32_t hasItems;                     // Bit per depth: a value already written at that level
+
+  bool makeRoom();
+  void put(char c);
+  void put(const char* s, size_t n);
+  void putUnsigned(unsigned long v);
+  void separator();
+  JsonWriter& open(char c);
+  JsonWriter& close(char c);
+};
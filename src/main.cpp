@@ -1,8 +1,23 @@
 #include <FastLED.h>
 #include <WiFi.h>
-#include <WebServer.h>
+#include <WiFiUdp.h>
 #include <ArduinoOTA.h>
 #include <EEPROM.h>
+#include <esp_task_wdt.h>
+#include <esp_pm.h>
+#include <esp_sleep.h>
+#include <driver/gpio.h>
+#include <hal/gpio_ll.h>
+#include <esp_timer.h>
+#include <esp_heap_caps.h>
+#include <lwip/sockets.h>
+#include "http_server.h"
+#include "json_writer.h"
+#include "gesture.h"
+#include "timer_wheel.h"
+#include <esp_freertos_hooks.h>
+#include <atomic>
+#include "web_assets.h"      // Generated from web/ by tools/embed_web.py
 
 // ESP32-S3 USB Support
 // Arduino IDE Settings: Tools -> USB CDC On Boot -> "Disabled" for flashing
@@ -45,23 +60,79 @@ struct {
   int16_t brakeThrottleMin;
   int16_t brakeThrottleMax;
   int16_t rpmFlickerThreshold;
-} settings = {0};
+} settings = {};
+
+// WiFi fast-connect cache (separate region so settings layout and CRC are unaffected)
+#define WIFI_CACHE_VERSION 2            // 2: lease no longer cached (DHCP on every connect)
+#define WIFI_CACHE_ADDR 256
+
+// Last known access point, rewritten only when it changes. The address always comes from
+// DHCP: reusing an old lease as a static IP outlives the lease and can clash with a client
+// the router later gives it to.
+struct WiFiCache {
+  uint8_t version;
+  uint32_t crc;                       // CRC32 of everything after this field
+  uint8_t bssid[6];
+  uint8_t channel;
+} wifiCache = {};
+
+// Radio-off mode settings (own region and CRC, like the WiFi cache)
+#define RADIO_SETTINGS_VERSION 1
+#define RADIO_SETTINGS_ADDR 320
+
+struct RadioSettings {
+  uint8_t version;
+  uint32_t crc;                       // CRC32 of everything after this field
+  uint16_t idleOffMinutes;            // Radio off after this long without a web request (0 = never)
+} radioSettings = {};
 
 // Forward declarations for settings management
 void loadSettings();
 void saveSettings();
+void timedCommit();
+void markSettingsDirty();
+bool settingsSaveDue();
+#ifdef AFTERFIRE_DIAGNOSTICS
+void serviceCommitStress();
+#endif
 uint32_t calculateSettingsCRC();
 bool validateSettings();
 void resetSettings();
+uint32_t crc32(const uint8_t* data, size_t len);
+void loadWiFiCache();
+void saveWiFiCache();
+void loadRadioSettings();
+void saveRadioSettings();
 void startAPMode();
 void setupAPWebServer();
+void startNetworkScan();
+void serviceNetworkScan();
+void drawAPIndicator();
+void beginWiFiConnect(bool allowFast);
+void serviceWiFi();
+void serviceRadio();
+void stopUdpStream();
+void noteWebRequest();
+void recordHandler(const char* uri);
+
+// Forward declarations for API responses
+void writeScanJson(JsonWriter& json);
+template <typename Writer> void sendJson(int code, Writer write);
+void serviceEventStreams();
+void sendResponse(int code, const char* contentType = "application/json");
+bool extractJsonString(const char* json, const char* key, char* out, size_t outSize);
+#ifdef AFTERFIRE_DIAGNOSTICS
+void runHeapSoakCheck();
+void runJsonWriterCheck();
+#endif
 
 ///////////////////////
 // USER CONFIG
 ///////////////////////
 
-// Web Server (always on port 80)
-WebServer server(80);
+// Web Server (always on port 80, served by its own task - see HTTP SERVER TASK)
+HttpServer server(80);
+TaskHandle_t httpTaskHandle = nullptr;
 
 // Hardware Config
 #define THROTTLE_PIN 2
@@ -73,42 +144,133 @@ WebServer server(80);
 
 // WiFi mode flags
 bool inAPMode = false;
-unsigned long wifiConnectTimeout = 0;
+unsigned long wifiConnectTimeout = 0;  // millis() deadline for the current connection attempt
+
+// WiFi station connection state (driven by serviceWiFi() from loop)
+enum WiFiState { WIFI_STATE_IDLE, WIFI_STATE_CONNECTING, WIFI_STATE_CONNECTED, WIFI_STATE_BACKOFF };
+WiFiState wifiState = WIFI_STATE_IDLE;
+bool wifiFastAttempt = false;          // Current attempt uses the cached BSSID/channel
+unsigned long wifiAttemptStart = 0;
+unsigned long wifiBackoffDelay = 0;    // Current backoff before the next attempt (ms)
+unsigned long wifiBackoffStart = 0;
+uint32_t wifiReconnectCount = 0;
+
+#define WIFI_FAST_CONNECT_TIMEOUT 4000 // ms to wait for a cached-BSSID connect (and its DHCP) before a full scan
+#define WIFI_CONNECT_TIMEOUT 10000     // ms to wait for a full connect
+#define WIFI_BACKOFF_MIN 1000          // ms before the first reconnect attempt
+#define WIFI_BACKOFF_MAX 60000         // ms cap for exponential backoff
+unsigned long apModeStartTime = 0;     // millis() when AP mode started (drives LED indicator)
+
+// Cached WiFi scan results (filled asynchronously, served instantly by /api/scan-networks)
+#define MAX_SCAN_RESULTS 20
+#define SCAN_CACHE_MAX_AGE 30000       // ms before a cached scan is considered stale
+struct ScanResult {
+  char ssid[33];
+  int8_t rssi;
+};
+ScanResult scanResults[MAX_SCAN_RESULTS];
+int scanResultCount = 0;
+unsigned long scanResultTime = 0;      // millis() when the cache was last filled (0 = never)
+bool scanInProgress = false;
+
+// New credentials from /api/wifi/save: staged by the server task, handed to the loop with
+// CMD_SAVE_WIFI (the loop owns settings and the EEPROM), then a restart once saved
+#define AP_RESTART_DELAY_MS 1000
+char stagedSSID[sizeof(settings.ssid)];
+char stagedPassword[sizeof(settings.password)];
+std::atomic<bool> wifiSaveStaged(false);   // Staged buffers handed over; never rewritten before the restart
+bool wifiSavePending = false;            // Loop: credentials copied into settings, not yet saved
+std::atomic<uint32_t> apRestartAt(0);    // millis() to restart at (0 = none), set by the loop once saved
 
 ///////////////////////
 
 CRGB leds[NUM_LEDS];
 
-volatile uint32_t pulseStart = 0;
-volatile uint16_t pulseWidth = 1500;
+// Throttle capture, published by the ISR on each falling edge as one consistent snapshot.
+// Readers use readCapture(): a seqlock, so they never disable interrupts and never see
+// a width from one pulse with the timestamp of another.
+enum CaptureFlags : uint8_t {
+  CAPTURE_SLEEP_DELAYED = 1 << 0,      // Rising edge landed in a sleep window; width kept from the previous pulse
+  CAPTURE_MISSED_EDGES = 1 << 1,       // Receiver frames were lost between this pulse and the last
+  CAPTURE_OUT_OF_RANGE = 1 << 2        // Width outside 500-2500 us (glitch or non-servo signal); width kept
+};
+struct CaptureState {
+  uint16_t width;                      // Last valid pulse width (us)
+  uint8_t flags;                       // CaptureFlags for the latest pulse
+  uint32_t riseTime;                   // Rising edge of the latest pulse (esp_timer us, same clock as micros())
+  uint32_t fallTime;                   // Falling edge of the latest pulse
+  uint32_t period;                     // Rising edge to rising edge (receiver frame period)
+  uint32_t frame;                      // Pulses completed since boot
+  uint32_t lostPulses;                 // Receiver frames whose edges never reached the ISR
+};
+CaptureState captureState = { 1500, 0, 0, 0, 0, 0, 0 };
+std::atomic<uint32_t> captureSeq(0);   // Odd while the ISR is writing captureState
+
+// ISR-private state for the pulse in progress
+uint32_t isrRiseTime = 0;
+uint32_t isrPeriod = 0;
+bool isrRoseInSleepWindow = false;
+bool isrMissedEdges = false;
+uint32_t isrLostPulses = 0;
+uint32_t nominalPulsePeriod = 0;       // Smoothed receiver frame period (0 = no signal)
+#define PULSE_SIGNAL_LOST_US 100000    // A gap this long is signal loss, not missed edges
+
+// Frame stalls - gaps between frames long enough to be visible (flash commits, blocking handlers)
+#define FRAME_STALL_US 25000
+uint32_t frameStalls = 0;
+uint32_t maxFrameStallUs = 0;
 
 uint16_t prevPulse = 1500;
 
-unsigned long lastEffectTime = 0;
 bool burstActive = false;
 int burstCount = 0;
 int burstIntensity = 0;
-
-// Runtime calibration variables (loaded from EEPROM on boot)
-// Standard RC PWM: 1000μs (brake) - 1500μs (neutral) - 2000μs (throttle)
-uint16_t NEUTRAL_MIN = 1475;   // Neutral deadzone lower bound
-uint16_t NEUTRAL_MAX = 1525;   // Neutral deadzone upper bound
-uint16_t MIN_PULSE = 1000;     // Full brake/reverse
-uint16_t MAX_PULSE = 2000;     // Full throttle
-uint16_t NEUTRAL_PULSE = 1500; // Center neutral
-
-// Runtime effect toggles (loaded from EEPROM on boot)
-bool enableBackfire = true;
-bool enableBrakeCrackle = true;
-bool enableIdleBurble = true;
-bool enableRPMFlicker = true;
-
-// Runtime sensitivity thresholds (loaded from EEPROM on boot)
-int backfireThrottleMin = 30;  // Minimum throttle before release to trigger
-int backfireReleaseMax = 15;   // Maximum throttle after release to trigger
-int brakeThrottleMin = 20;     // Throttle needed before braking
-int brakeThrottleMax = -20;    // Brake position to trigger
-int rpmFlickerThreshold = 30;  // Throttle % needed before RPM flicker starts
+uint8_t burstEffect = 0;               // EffectId that started the current burst
+bool burbleDue = false;                // Burble timer fired, waiting for a frame with the throttle
+#define BURBLE_MEAN_INTERVAL_MS 1250   // Same average rate as the old 4-in-1000 chance per 5 ms frame
+
+// Runtime configuration (loaded from EEPROM on boot). Never modified in place: changes
+// are published as a new snapshot, see CONFIG SNAPSHOTS.
+struct RenderConfig {
+  // Calibration - standard RC PWM: 1000μs (brake) - 1500μs (neutral) - 2000μs (throttle)
+  uint16_t neutralMin;          // Neutral deadzone lower bound
+  uint16_t neutralMax;          // Neutral deadzone upper bound
+  uint16_t minPulse;            // Full brake/reverse
+  uint16_t maxPulse;            // Full throttle
+  uint16_t neutralPulse;        // Center neutral
+  
+  // Effect toggles
+  bool enableBackfire;
+  bool enableBrakeCrackle;
+  bool enableIdleBurble;
+  bool enableRPMFlicker;
+  
+  // Sensitivity thresholds
+  int16_t backfireThrottleMin;  // Minimum throttle before release to trigger
+  int16_t backfireReleaseMax;   // Maximum throttle after release to trigger
+  int16_t brakeThrottleMin;     // Throttle needed before braking
+  int16_t brakeThrottleMax;     // Brake position to trigger
+  int16_t rpmFlickerThreshold;  // Throttle % needed before RPM flicker starts
+};
+const RenderConfig DEFAULT_CONFIG = {
+  1475, 1525, 1000, 2000, 1500,
+  true, true, true, true,
+  30, 15, 20, -20, 30
+};
+
+// Read-copy-update: a writer fills a free slot and swaps the active pointer, readers load
+// the pointer without locks. A replaced slot is reused only once every reader has passed
+// a quiescent point (start of a loop / end of a request) since the swap.
+#define CONFIG_SLOTS 4
+enum ConfigReader : uint8_t { CONFIG_READER_PIPELINE, CONFIG_READER_WEB, CONFIG_READER_COUNT };
+RenderConfig configSlots[CONFIG_SLOTS];
+uint32_t configRetiredAt[CONFIG_SLOTS];         // Generation that replaced each slot (0 = never used)
+std::atomic<RenderConfig*> activeConfig(nullptr);
+std::atomic<uint32_t> configGeneration(1);      // Bumped by every publish
+std::atomic<uint32_t> configReaderSeen[CONFIG_READER_COUNT];  // Generation at each reader's last quiescent point
+portMUX_TYPE configWriteMux = portMUX_INITIALIZER_UNLOCKED;  // Serialises writers (readers never take it)
+uint32_t configSavedGeneration = 0;             // Generation last handed to the settings saver
+const RenderConfig* config = &DEFAULT_CONFIG;   // Snapshot the current loop iteration renders with
 
 // Calibration state
 enum CalibrationStep { CAL_IDLE, CAL_NEUTRAL, CAL_THROTTLE, CAL_BRAKE, CAL_COMPLETE };
@@ -117,6 +279,299 @@ uint16_t calibratedNeutral = 0;
 uint16_t calibratedThrottle = 0;
 uint16_t calibratedBrake = 0;
 
+// Actions from web handlers to the frame pipeline (single producer, single consumer).
+// Configuration changes don't go through here - they are published as config snapshots.
+enum CommandType : uint8_t {
+  CMD_TRIGGER_BURST,      // param = EffectId it stands in for, a = burst count, b = intensity
+  CMD_CALIBRATE_START,
+  CMD_CALIBRATE_CAPTURE,  // param = CalibrationStep being captured, a = pulse width
+  CMD_RESET_METRICS,
+  CMD_RADIO_OFF,          // Arms the radio-off timer (the wheel belongs to the loop task)
+  CMD_SAVE_WIFI           // Saves stagedSSID/stagedPassword, then restarts
+};
+enum EffectId : uint8_t { EFFECT_BACKFIRE, EFFECT_BRAKE_CRACKLE, EFFECT_IDLE_BURBLE, EFFECT_RPM_FLICKER };
+
+struct Command {
+  CommandType type;
+  uint8_t param;
+  int16_t a;
+  int16_t b;
+};
+
+#define COMMAND_QUEUE_SIZE 16           // must be a power of two
+Command commandQueue[COMMAND_QUEUE_SIZE];
+std::atomic<uint32_t> commandHead(0);   // next slot to write (advanced by producer only)
+std::atomic<uint32_t> commandTail(0);   // next slot to read (advanced by consumer only)
+uint32_t commandsDropped = 0;
+
+// Set by the pipeline when a command changed persistent settings; saved outside the frame.
+// EEPROM.commit() stalls the loop for the flash write, so saves wait for slider changes
+// to settle and for a steady frame (up to a limit).
+#define SETTINGS_SAVE_DELAY_MS 1000      // Quiet time after the last change before saving
+#define SETTINGS_SAVE_MAX_DEFER_MS 10000 // Save anyway after this long, even mid-transient
+bool settingsDirty = false;
+unsigned long settingsChangedTime = 0;   // millis() of the latest unsaved change
+unsigned long settingsDirtySince = 0;    // millis() of the oldest unsaved change
+uint32_t flashCommits = 0;
+uint32_t maxFlashCommitUs = 0;
+
+// Per-stage timing histograms (cycle counts, log-linear buckets: 4 per power of two)
+enum Stage : uint8_t {
+  STAGE_HOUSEKEEPING, STAGE_OTA, STAGE_FRAME,
+  STAGE_INPUT, STAGE_MAPPING, STAGE_DEBUG,
+  STAGE_RPM_FLICKER, STAGE_BACKFIRE, STAGE_BRAKE_CRACKLE, STAGE_IDLE_BURBLE, STAGE_EFFECT_TIMERS,
+  STAGE_SHOW,
+  STAGE_COUNT
+};
+const char* const STAGE_NAMES[STAGE_COUNT] = {
+  "housekeeping", "otaHandle", "frame",
+  "input", "mapping", "debug",
+  "rpmFlicker", "backfire", "brakeCrackle", "idleBurble", "effectTimers",
+  "show"
+};
+
+#define PROFILE_BUCKETS 128
+struct StageProfile {
+  uint32_t buckets[PROFILE_BUCKETS];
+  uint32_t count;
+  uint32_t maxCycles;
+};
+StageProfile stageProfiles[STAGE_COUNT];
+uint32_t frameStageCycles[STAGE_COUNT];  // Per-loop totals, used to blame deadline misses
+volatile uint8_t currentStage = STAGE_COUNT;  // Innermost stage executing (STAGE_COUNT = none)
+
+// Adaptive frame rate: fast while the input moves or a burst runs, steady otherwise
+// (idle mode below takes over once nothing is animating)
+#define FRAME_PERIOD_FAST_MS 2          // 500 Hz during transients
+#define FRAME_PERIOD_STEADY_MS 5        // 200 Hz while an effect renders at steady input
+#define TRANSIENT_HOLD_MS 250           // Stay fast this long after the last input change
+#define PULSE_JITTER_US 8               // Pulse changes at or below this are receiver jitter
+bool fastFrames = false;
+unsigned long lastInputChangeTime = 0;
+uint32_t lastFrameMicros = 0;
+uint32_t frameDtUs = 5000;              // Time since the previous frame (scales fades)
+uint32_t frameCounter = 0;              // Frames rendered since the last rate sample
+float frameRateHz = 0;
+
+// Frame-budget governor: before each frame, pick the highest detail tier whose learned
+// render cost fits what is left of the deadline after web and housekeeping work
+enum DetailTier : uint8_t { TIER_FULL, TIER_REDUCED, TIER_MINIMAL, TIER_COUNT };
+const char* const TIER_NAMES[TIER_COUNT] = { "full", "reduced", "minimal" };
+#define GOVERNOR_MARGIN_US 300           // Kept free for the debug line and telemetry after the frame
+#define GOVERNOR_RESTORE_HOLD_MS 250     // Detail comes back only after this long without pressure
+#define GOVERNOR_COST_DECAY 32           // Cost estimates fall 1/32 of the way to a cheaper sample
+#define FLICKER_REDUCED_PERIOD_MS 20     // RPM flicker noise rate at reduced detail
+
+// Effects with cost tiers. Each is timed by its own stage; its cost is learned per tier
+// (decaying peak, us) so the governor can predict the frame at every tier
+struct EffectCost {
+  uint8_t stage;
+  float costUs[TIER_COUNT];
+};
+EffectCost effectCosts[] = {
+  { STAGE_RPM_FLICKER, {} },             // full: flicker noise every 5 ms; reduced: every 20 ms; minimal: none
+  { STAGE_EFFECT_TIMERS, {} },           // Burst flashes - full: random shade per flash; reduced/minimal: fixed shades
+  { STAGE_SHOW, {} },                    // full: dithered, every frame; reduced: undithered, changed
+                                         // frames only; minimal: as reduced, at most every 5 ms
+};
+float frameBaseCostUs = 0;               // Rest of the frame (input, mapping, detectors)
+DetailTier frameTier = TIER_FULL;
+unsigned long tierPressureTime = 0;      // millis() when a lower tier was last needed
+uint32_t tierFrames[TIER_COUNT] = {};
+
+// Phase lock and late latch: the frame renders straight after the wait, which ends on a
+// receiver pulse or on a tick that is pulled onto the next expected pulse
+#define PHASE_LOCK_GUARD_US 500          // Extra wait past the expected edge before giving up on it
+uint32_t frameDueUs = 0;                 // When the current frame became due (pulse edge or tick)
+uint32_t phaseLockedFrames = 0;          // Ticks moved onto the next receiver frame
+
+// Falling edge of a new pulse to the end of the frame that first shows it
+struct LatencyStats {
+  uint32_t count;
+  uint64_t sumUs;
+  uint32_t maxUs;
+  uint32_t lastUs;
+};
+LatencyStats edgeToOutput = {};
+
+// Per-frame telemetry, published by the pipeline for web, serial and streaming consumers.
+// The pipeline fills the back buffer during the frame and flips at the end of the loop.
+struct Telemetry {
+  uint32_t frame;                       // Frames published since boot
+  uint32_t timeMs;                      // millis() at publish
+  uint16_t pulse;                       // Pulse width the frame rendered (us)
+  int8_t throttle;                      // -100 .. 100
+  int8_t prevThrottle;                  // Throttle of the previous frame
+  uint8_t captureFlags;                 // CaptureFlags of the rendered pulse
+  uint8_t calibrationStep;
+  uint8_t burstCount;                   // Flashes left in the current burst
+  bool burstActive;
+  bool idle;
+  bool fastFrames;
+  CRGB led;                             // First LED as shown
+  uint8_t detailTier;                   // DetailTier the frame rendered at
+  uint16_t latencyUs;                   // Edge-to-output latency of the newest pulse shown
+  uint32_t frameStartUs;                // micros() when the frame started
+  uint32_t frameDtUs;                   // Interval since the previous frame
+  uint32_t workUs;                      // Loop work for this frame, excluding the wait
+  uint8_t activeEffects;                // Bit per EffectId drawing this frame
+};
+Telemetry telemetryBuffers[2];
+std::atomic<uint32_t> telemetrySeq(0);  // Publishes so far; telemetryBuffers[seq & 1] is the latest
+
+// Frame deadline tracking - loop work (excluding the frame delay) must fit one frame period
+#define DEADLINE_LOG_SIZE 16
+struct DeadlineMiss {
+  uint32_t timeMs;                      // millis() when the miss was detected
+  uint32_t deadlineUs;                  // Frame period in force at the time
+  uint32_t durationUs;                  // Total loop work time
+  uint8_t stage;                        // Stage that took the most time in that loop
+  uint32_t stageUs;
+};
+DeadlineMiss deadlineLog[DEADLINE_LOG_SIZE];
+uint32_t deadlineMissCount = 0;         // Total misses since boot (log keeps the latest 16)
+
+// Task watchdog for the loop and server tasks - a hung stage or handler reboots the device
+// instead of going dark
+#define WDT_TIMEOUT_S 3
+#define WDT_STAGE_MAGIC 0xAF7E0055
+#define WDT_HANDLER_LENGTH 40
+RTC_NOINIT_ATTR uint32_t wdtStageMagic;  // Survives the watchdog reset
+RTC_NOINIT_ATTR uint8_t wdtStage;
+RTC_NOINIT_ATTR char wdtHandler[WDT_HANDLER_LENGTH];  // Path of the handler running on the server task ("" = none)
+int8_t lastResetStage = -1;              // Stage that hung before the last watchdog reset (-1 = none)
+char lastResetHandler[WDT_HANDLER_LENGTH] = "";  // Handler running at the last watchdog reset ("" = none)
+
+// Idle power management: at neutral with nothing animating the loop drops to a low
+// CPU clock and light-sleeps in the gap between receiver pulses
+enum PowerMode { PM_NONE, PM_MANUAL_DFS, PM_DFS, PM_LIGHT_SLEEP };
+const char* const POWER_MODE_NAMES[] = { "none", "manualDfs", "dfs", "lightSleep" };
+PowerMode powerMode = PM_NONE;
+esp_pm_lock_handle_t cpuFreqLock = nullptr;   // Held while rendering actively (full CPU clock)
+esp_pm_lock_handle_t noSleepLock = nullptr;   // Held outside sleep windows (no light sleep)
+TaskHandle_t loopTaskHandle = nullptr;
+BaseType_t loopCore = 1;                      // Core the loop task runs on (set in setup)
+
+#define CPU_FREQ_ACTIVE_MHZ 240
+#define CPU_FREQ_IDLE_MHZ 80
+#define IDLE_ENTER_MS 500                // Static neutral input with nothing animating before idling
+#define IDLE_MAX_WAIT_MS 20              // Upper bound on an idle wait (bounds wake latency without signal)
+#define IDLE_WAKE_GUARD_US 1500          // Wake this long before the next expected rising edge
+#define IDLE_MIN_SLEEP_US 3000           // Don't bother opening a sleep window shorter than this
+
+// Typical ESP32-S3 CPU current (datasheet figures, radio and LEDs excluded)
+#define CURRENT_ACTIVE_MA 43.0f
+#define CURRENT_DFS_MA 22.0f
+#define CURRENT_LIGHT_SLEEP_MA 1.5f
+
+volatile bool idleMode = false;
+volatile bool sleepWindowOpen = false;   // Light sleep allowed (read by the ISR)
+unsigned long lastActivityTime = 0;
+bool frameActive = true;                 // Set by renderFrame(): false when the frame changed nothing
+uint32_t pulseFrames = 0;                // Active frames started by a pulse notification
+uint32_t deadlineFrames = 0;             // Active frames started by the frame period / effect timer
+CRGB lastShownLeds[NUM_LEDS];
+
+struct PowerStats {
+  uint32_t idleEntries;
+  uint64_t idleUs;                       // Time accounting since the last 1 s sample
+  uint64_t sleepWindowUs;
+  float activeFraction;                  // Last 1 s sample
+  float idleFraction;
+  float sleepFraction;
+  float estCurrentMa;
+  uint32_t timerWakeCount;
+  uint64_t timerWakeLatencySumUs;        // Sleep window end: requested vs actual resume
+  uint32_t timerWakeLatencyMaxUs;
+  uint32_t edgeWakeCount;
+  uint64_t edgeWakeLatencySumUs;         // Falling edge to loop resume while idle
+  uint32_t edgeWakeLatencyMaxUs;
+  uint32_t discardedPulses;              // Pulses whose rising edge landed in a sleep window
+};
+PowerStats powerStats = {};
+uint32_t powerAccountStart = 0;
+
+// CPU load per core, sampled once a second: exact from FreeRTOS run-time stats when the
+// SDK has them, otherwise sampled from each core's tick interrupt
+#define CPU_LOAD_INTERVAL_MS 1000
+struct CoreLoad {
+  float load;                            // Busy share of the last interval (0..1)
+  float peakLoad;                        // Highest interval since boot or metrics reset
+};
+CoreLoad coreLoad[portNUM_PROCESSORS] = {};
+
+// Memory health - heap and task stacks sampled into a ring so trends survive between page loads
+#define MEMORY_SAMPLE_INTERVAL_MS 10000  // 60 samples = the last 10 minutes
+#define MEMORY_HISTORY_SIZE 60
+#define MAX_TRACKED_TASKS 20
+struct MemorySample {
+  uint32_t timeMs;
+  uint32_t freeHeap;
+  uint32_t largestBlock;
+  uint32_t minFreeHeap;                  // Lowest free heap since boot
+};
+MemorySample memoryHistory[MEMORY_HISTORY_SIZE];
+uint32_t memorySampleCount = 0;          // Total samples since boot (ring keeps the latest 60)
+
+struct TaskStackInfo {
+  char name[16];
+  uint32_t stackFreeBytes;               // High-water mark: least free stack ever seen
+};
+TaskStackInfo taskStacks[MAX_TRACKED_TASKS];
+uint8_t taskStackCount = 0;
+uint16_t taskCountTotal = 0;             // Tasks running (may exceed the ones tracked)
+
+// Radio-off mode: WiFi fully stopped for race runs (no radio interrupts or current draw).
+// Turned off after an idle period without web requests or by /api/radio/off; brought
+// back by the full-brake hold gesture, or by a power cycle
+#define RADIO_IDLE_OFF_MAX_MIN 240
+#define RADIO_OFF_DELAY_MS 500           // Lets the /api/radio/off response reach the client first
+#define CURRENT_RADIO_MA 25.0f           // Connected station with modem sleep, averaged (estimate)
+
+bool radioOn = true;
+bool radioServicesPending = false;       // Web server and OTA restart once the station reconnects
+bool radioWakeRequested = false;         // Set by the frame pipeline's brake-hold gesture
+std::atomic<bool> radioTeardownPending(false);  // Set by radioOff(); the server task stops WiFi and clears it
+unsigned long radioStateSince = 0;
+std::atomic<uint32_t> lastWebRequestTime(0);  // millis() of the latest request (set by the server task)
+std::atomic<uint16_t> radioIdleOffMinutes(0);  // Set by /api/radio (server task), persisted by the loop
+
+// Input timing and current per radio state ([0] = on, [1] = off)
+struct RadioStateStats {
+  uint32_t periods;
+  uint64_t periodJitterSumUs;            // |period - previous period|, from ISR timestamps
+  uint32_t periodJitterMaxUs;
+  uint32_t latencyCount;
+  uint64_t latencySumUs;                 // Falling edge to the first frame that reads the pulse
+  uint32_t latencyMaxUs;
+  uint32_t seconds;
+  float currentSumMa;                    // Estimated CPU + radio current, summed once a second
+};
+RadioStateStats radioStats[2] = {};
+
+// Stick gestures (recogniser in gesture.h)
+#define GESTURE_FEEDBACK_MS 400          // LED confirmation flash
+GestureState stickGestures = {};
+
+// Effect presets cycled by the triple-blip gesture (bit per EffectId)
+#define EFFECT_BIT(effect) (1 << (effect))
+#define ALL_EFFECTS 0x0F
+struct EffectPreset {
+  const char* name;
+  uint8_t effects;
+  CRGB colour;                           // Confirmation flash
+};
+const EffectPreset EFFECT_PRESETS[] = {
+  { "full", ALL_EFFECTS, CRGB(255, 255, 255) },
+  { "race", EFFECT_BIT(EFFECT_BACKFIRE) | EFFECT_BIT(EFFECT_RPM_FLICKER), CRGB(255, 60, 0) },
+  { "show", EFFECT_BIT(EFFECT_BACKFIRE) | EFFECT_BIT(EFFECT_BRAKE_CRACKLE) | EFFECT_BIT(EFFECT_IDLE_BURBLE), CRGB(160, 0, 255) },
+};
+#define EFFECT_PRESET_COUNT (sizeof(EFFECT_PRESETS) / sizeof(EFFECT_PRESETS[0]))
+uint8_t effectPresetIndex = 0;
+uint8_t mutedEffects = 0;                // Effects the triple brake blip turned off (restored by the next one)
+CRGB gestureFeedbackColour;
+bool gestureFeedbackActive = false;
+
 ///////////////////////
 // FORWARD DECLARATIONS
 ///////////////////////
@@ -125,18 +580,76 @@ void setupWebServer();
 void handleRPMFlicker(int throttle);
 void detectBackfire(int prev, int now);
 void detectBrakeCrackle(int prev, int now);
-void handleBurst();
+void startBurst(uint8_t source, int count, int intensity);
+void burstStep();
 void idleBurble(int throttle);
+void scheduleNextBurble();
+void burbleFired();
+void flickerNoiseStep();
+void endGestureFeedback();
+void endCalibrationFlash();
 void setFlame(int heat);
+bool pushCommand(CommandType type, uint8_t param = 0, int16_t a = 0, int16_t b = 0);
+uint32_t applyCommands();
+CaptureState readCapture();
+Telemetry& telemetryBack();
+void publishTelemetry(uint32_t workUs);
+Telemetry readTelemetry();
+void printTelemetry();
+void renderFrame();
+int pulseToThrottle(uint16_t pulse, const RenderConfig& cfg);
+void publishInitialConfig(const RenderConfig& initial);
+void applyGesture(Gesture gesture);
+void drawGestureFeedback();
+const RenderConfig* configAcquire();
+void configQuiescent(ConfigReader reader);
+
+
+///////////////////////
+// TIMER WHEEL
+///////////////////////
+
+// Frame pipeline timers (advanced once per frame, before the effects)
+enum EffectTimer : uint8_t {
+  TIMER_BURST, TIMER_BURBLE, TIMER_FLICKER_NOISE, TIMER_GESTURE_FEEDBACK, TIMER_CAL_FLASH,
+  EFFECT_TIMER_COUNT
+};
+// Loop housekeeping timers (advanced once per loop, after the web server)
+enum HousekeepingTimer : uint8_t {
+  TIMER_DEBUG_LINE, TIMER_POWER_SAMPLE, TIMER_CPU_SAMPLE, TIMER_MEMORY_SAMPLE, TIMER_RADIO_OFF,
+  HOUSEKEEPING_TIMER_COUNT
+};
+#define DEBUG_INTERVAL_MS 500
+#define POWER_SAMPLE_INTERVAL_MS 1000
+#define CAL_FLASH_MS 1000                // Green after a completed calibration
+
+WheelTimer effectTimerSlots[EFFECT_TIMER_COUNT];
+WheelTimer housekeepingTimerSlots[HOUSEKEEPING_TIMER_COUNT];
+TimerWheel effectTimers;                 // Given their slots by timerInit() in startTimers()
+TimerWheel housekeepingTimers;
+
+void scheduleEffectTimer(uint8_t id, uint32_t delayMs) {
+  timerSchedule(effectTimers, id, millis(), delayMs);
+}
+
+void scheduleHousekeepingTimer(uint8_t id, uint32_t delayMs) {
+  timerSchedule(housekeepingTimers, id, millis(), delayMs);
+}
+
+// Longest a frame wait may last without missing an effect timer, capped at limitMs
+uint32_t msUntilEffectTimer(uint32_t limitMs) {
+  uint32_t due;
+  if (!timerNextDue(effectTimers, due)) return limitMs;
+  long until = (long)(due - millis());
+  return constrain(until, 0L, (long)limitMs);
+}
 
 ///////////////////////
 // EEPROM MANAGEMENT
 ///////////////////////
 
-uint32_t calculateSettingsCRC() {
+uint32_t crc32(const uint8_t* data, size_t len) {
   uint32_t crc = 0xFFFFFFFF;
-  uint8_t* data = (uint8_t*)&settings + 5; // Skip version and crc fields
-  size_t len = sizeof(settings) - 5;
   
   for (size_t i = 0; i < len; i++) {
     crc ^= data[i];
@@ -147,6 +660,20 @@ uint32_t calculateSettingsCRC() {
   return crc ^ 0xFFFFFFFF;
 }
 
+uint32_t calculateSettingsCRC() {
+  return crc32((uint8_t*)&settings + 5, sizeof(settings) - 5); // Skip version and crc fields
+}
+
+uint32_t calculateWiFiCacheCRC() {
+  size_t offset = offsetof(WiFiCache, bssid);
+  return crc32((uint8_t*)&wifiCache + offset, sizeof(wifiCache) - offset);
+}
+
+uint32_t calculateRadioSettingsCRC() {
+  size_t offset = offsetof(RadioSettings, idleOffMinutes);
+  return crc32((uint8_t*)&radioSettings + offset, sizeof(radioSettings) - offset);
+}
+
 bool validateSettings() {
   return settings.version == SETTINGS_VERSION && settings.crc == calculateSettingsCRC();
 }
@@ -158,46 +685,32 @@ void loadSettings() {
   if (validateSettings()) {
     USBSerial.println("[Settings] ✓ Valid settings found");
     
-    // Load into runtime variables
-    NEUTRAL_MIN = settings.neutralMin;
-    NEUTRAL_MAX = settings.neutralMax;
-    MIN_PULSE = settings.minPulse;
-    MAX_PULSE = settings.maxPulse;
-    NEUTRAL_PULSE = settings.neutralPulse;
+    // Publish as the first config snapshot
+    RenderConfig loaded;
+    loaded.neutralMin = settings.neutralMin;
+    loaded.neutralMax = settings.neutralMax;
+    loaded.minPulse = settings.minPulse;
+    loaded.maxPulse = settings.maxPulse;
+    loaded.neutralPulse = settings.neutralPulse;
     
-    enableBackfire = settings.enableBackfire;
-    enableBrakeCrackle = settings.enableBrakeCrackle;
-    enableIdleBurble = settings.enableIdleBurble;
-    enableRPMFlicker = settings.enableRPMFlicker;
+    loaded.enableBackfire = settings.enableBackfire;
+    loaded.enableBrakeCrackle = settings.enableBrakeCrackle;
+    loaded.enableIdleBurble = settings.enableIdleBurble;
+    loaded.enableRPMFlicker = settings.enableRPMFlicker;
     
-    backfireThrottleMin = settings.backfireThrottleMin;
-    backfireReleaseMax = settings.backfireReleaseMax;
-    brakeThrottleMin = settings.brakeThrottleMin;
-    brakeThrottleMax = settings.brakeThrottleMax;
-    rpmFlickerThreshold = settings.rpmFlickerThreshold;
+    loaded.backfireThrottleMin = settings.backfireThrottleMin;
+    loaded.backfireReleaseMax = settings.backfireReleaseMax;
+    loaded.brakeThrottleMin = settings.brakeThrottleMin;
+    loaded.brakeThrottleMax = settings.brakeThrottleMax;
+    loaded.rpmFlickerThreshold = settings.rpmFlickerThreshold;
+    publishInitialConfig(loaded);
     
     USBSerial.println("[Settings] Calibration loaded from EEPROM");
   } else {
     USBSerial.println("[Settings] No valid settings in EEPROM, initializing defaults");
     
-    // Initialize with current runtime defaults (from variable declarations)
-    settings.version = SETTINGS_VERSION;
-    settings.neutralMin = NEUTRAL_MIN;
-    settings.neutralMax = NEUTRAL_MAX;
-    settings.minPulse = MIN_PULSE;
-    settings.maxPulse = MAX_PULSE;
-    settings.neutralPulse = NEUTRAL_PULSE;
-    
-    settings.enableBackfire = enableBackfire;
-    settings.enableBrakeCrackle = enableBrakeCrackle;
-    settings.enableIdleBurble = enableIdleBurble;
-    settings.enableRPMFlicker = enableRPMFlicker;
-    
-    settings.backfireThrottleMin = backfireThrottleMin;
-    settings.backfireReleaseMax = backfireReleaseMax;
-    settings.brakeThrottleMin = brakeThrottleMin;
-    settings.brakeThrottleMax = brakeThrottleMax;
-    settings.rpmFlickerThreshold = rpmFlickerThreshold;
+    // Initialize with the built-in defaults
+    publishInitialConfig(DEFAULT_CONFIG);
     
     // Save the defaults to EEPROM
     saveSettings();
@@ -206,44 +719,177 @@ void loadSettings() {
 }
 
 void saveSettings() {
-  // Update struct from runtime variables
+  // Update struct from the current config snapshot
+  const RenderConfig& cfg = *configAcquire();
   settings.version = SETTINGS_VERSION;
-  settings.neutralMin = NEUTRAL_MIN;
-  settings.neutralMax = NEUTRAL_MAX;
-  settings.minPulse = MIN_PULSE;
-  settings.maxPulse = MAX_PULSE;
-  settings.neutralPulse = NEUTRAL_PULSE;
-  
-  settings.enableBackfire = enableBackfire;
-  settings.enableBrakeCrackle = enableBrakeCrackle;
-  settings.enableIdleBurble = enableIdleBurble;
-  settings.enableRPMFlicker = enableRPMFlicker;
-  
-  settings.backfireThrottleMin = backfireThrottleMin;
-  settings.backfireReleaseMax = backfireReleaseMax;
-  settings.brakeThrottleMin = brakeThrottleMin;
-  settings.brakeThrottleMax = brakeThrottleMax;
-  settings.rpmFlickerThreshold = rpmFlickerThreshold;
+  settings.neutralMin = cfg.neutralMin;
+  settings.neutralMax = cfg.neutralMax;
+  settings.minPulse = cfg.minPulse;
+  settings.maxPulse = cfg.maxPulse;
+  settings.neutralPulse = cfg.neutralPulse;
+  
+  settings.enableBackfire = cfg.enableBackfire;
+  settings.enableBrakeCrackle = cfg.enableBrakeCrackle;
+  settings.enableIdleBurble = cfg.enableIdleBurble;
+  settings.enableRPMFlicker = cfg.enableRPMFlicker;
+  
+  settings.backfireThrottleMin = cfg.backfireThrottleMin;
+  settings.backfireReleaseMax = cfg.backfireReleaseMax;
+  settings.brakeThrottleMin = cfg.brakeThrottleMin;
+  settings.brakeThrottleMax = cfg.brakeThrottleMax;
+  settings.rpmFlickerThreshold = cfg.rpmFlickerThreshold;
   
   // Calculate and store CRC
   settings.crc = calculateSettingsCRC();
   
   // Write to EEPROM
   EEPROM.writeBytes(SETTINGS_START_ADDR, &settings, sizeof(settings));
-  EEPROM.commit();
+  timedCommit();
   
   USBSerial.println("[Settings] ✓ Settings saved to EEPROM");
 }
 
+// EEPROM.commit() with its flash stall recorded (the capture ISR keeps running from IRAM)
+void timedCommit() {
+  uint32_t start = micros();
+  EEPROM.commit();
+  uint32_t elapsed = micros() - start;
+  flashCommits++;
+  if (elapsed > maxFlashCommitUs) maxFlashCommitUs = elapsed;
+}
+
+void markSettingsDirty() {
+  if (!settingsDirty) settingsDirtySince = millis();
+  settingsDirty = true;
+  settingsChangedTime = millis();
+}
+
+// True once pending changes have settled and the loop isn't animating a transient
+bool settingsSaveDue() {
+  if (!settingsDirty) return false;
+  if (millis() - settingsDirtySince >= SETTINGS_SAVE_MAX_DEFER_MS) return true;
+  return millis() - settingsChangedTime >= SETTINGS_SAVE_DELAY_MS && !fastFrames && !burstActive;
+}
+
+#ifdef AFTERFIRE_DIAGNOSTICS
+// Commit stress: back-to-back EEPROM commits for 10 s while the loop keeps rendering,
+// then report pulses the capture ISR lost and frames that stalled
+#define COMMIT_STRESS_START_MS 15000     // After boot, once the receiver is up
+#define COMMIT_STRESS_DURATION_MS 10000
+#define COMMIT_STRESS_INTERVAL_MS 50
+#define DIAG_SCRATCH_ADDR (EEPROM_SIZE - 1)  // Unused byte, toggled so every commit really writes
+
+void serviceCommitStress() {
+  static uint8_t phase = 0;              // 0 = waiting, 1 = running, 2 = done
+  static unsigned long phaseStart = 0;
+  static unsigned long lastCommit = 0;
+  static uint32_t commits = 0;
+  static uint32_t pulsesAtStart, lostAtStart, stallsAtStart;
+  
+  if (phase == 2) return;
+  if (phase == 0) {
+    if (millis() < COMMIT_STRESS_START_MS) return;
+    USBSerial.println("[Diag] Commit stress: 10 s of EEPROM commits");
+    phase = 1;
+    phaseStart = millis();
+    CaptureState capture = readCapture();
+    pulsesAtStart = capture.frame;
+    lostAtStart = capture.lostPulses;
+    stallsAtStart = frameStalls;
+    maxFrameStallUs = 0;
+  }
+  
+  if (millis() - phaseStart < COMMIT_STRESS_DURATION_MS) {
+    if (millis() - lastCommit >= COMMIT_STRESS_INTERVAL_MS) {
+      lastCommit = millis();
+      EEPROM.write(DIAG_SCRATCH_ADDR, (commits & 1) ? 0xA5 : 0x5A);
+      timedCommit();
+      commits++;
+    }
+    return;
+  }
+  
+  phase = 2;
+  CaptureState capture = readCapture();
+  uint32_t pulses = capture.frame - pulsesAtStart;
+  uint32_t lost = capture.lostPulses - lostAtStart;
+  USBSerial.printf("[Diag] Commit stress: %u commits (max %u us), %u pulses, %u lost, %u frame stalls (max %u us): ",
+                   (unsigned)commits, (unsigned)maxFlashCommitUs, (unsigned)pulses, (unsigned)lost,
+                   (unsigned)(frameStalls - stallsAtStart), (unsigned)maxFrameStallUs);
+  if (pulses == 0) {
+    USBSerial.println("SKIPPED (no receiver signal)");
+  } else {
+    USBSerial.println(lost == 0 ? "PASS" : "FAIL");
+  }
+}
+#endif
+
 void resetSettings() {
   memset(&settings, 0, sizeof(settings));
   memset(settings.ssid, 0, sizeof(settings.ssid));
   memset(settings.password, 0, sizeof(settings.password));
   EEPROM.writeBytes(SETTINGS_START_ADDR, &settings, sizeof(settings));
+  memset(&wifiCache, 0, sizeof(wifiCache));
+  EEPROM.writeBytes(WIFI_CACHE_ADDR, &wifiCache, sizeof(wifiCache));
+  memset(&radioSettings, 0, sizeof(radioSettings));
+  EEPROM.writeBytes(RADIO_SETTINGS_ADDR, &radioSettings, sizeof(radioSettings));
   EEPROM.commit();
   USBSerial.println("[Settings] EEPROM cleared");
 }
 
+void loadWiFiCache() {
+  EEPROM.readBytes(WIFI_CACHE_ADDR, &wifiCache, sizeof(wifiCache));
+  
+  if (wifiCache.version != WIFI_CACHE_VERSION || wifiCache.crc != calculateWiFiCacheCRC()) {
+    memset(&wifiCache, 0, sizeof(wifiCache));
+    USBSerial.println("[WiFi] No fast-connect cache");
+    return;
+  }
+  USBSerial.print("[WiFi] Fast-connect cache: channel ");
+  USBSerial.println(wifiCache.channel);
+}
+
+// Store the current BSSID and channel; skips the flash write if nothing changed
+void saveWiFiCache() {
+  uint8_t* bssid = WiFi.BSSID();
+  if (bssid == nullptr) return;
+  
+  bool changed = wifiCache.version != WIFI_CACHE_VERSION ||
+                 memcmp(wifiCache.bssid, bssid, sizeof(wifiCache.bssid)) != 0 ||
+                 wifiCache.channel != WiFi.channel();
+  if (!changed) return;
+  
+  wifiCache.version = WIFI_CACHE_VERSION;
+  memcpy(wifiCache.bssid, bssid, sizeof(wifiCache.bssid));
+  wifiCache.channel = WiFi.channel();
+  wifiCache.crc = calculateWiFiCacheCRC();
+  
+  EEPROM.writeBytes(WIFI_CACHE_ADDR, &wifiCache, sizeof(wifiCache));
+  timedCommit();
+  USBSerial.println("[WiFi] ✓ Fast-connect cache saved");
+}
+
+void loadRadioSettings() {
+  EEPROM.readBytes(RADIO_SETTINGS_ADDR, &radioSettings, sizeof(radioSettings));
+  
+  if (radioSettings.version != RADIO_SETTINGS_VERSION || radioSettings.crc != calculateRadioSettingsCRC()) {
+    memset(&radioSettings, 0, sizeof(radioSettings));
+  }
+  radioIdleOffMinutes = min<uint16_t>(radioSettings.idleOffMinutes, RADIO_IDLE_OFF_MAX_MIN);
+  if (radioIdleOffMinutes > 0) {
+    USBSerial.printf("[Radio] Off after %u min without web requests\n", radioIdleOffMinutes.load());
+  }
+}
+
+void saveRadioSettings() {
+  radioSettings.version = RADIO_SETTINGS_VERSION;
+  radioSettings.idleOffMinutes = radioIdleOffMinutes;
+  radioSettings.crc = calculateRadioSettingsCRC();
+  EEPROM.writeBytes(RADIO_SETTINGS_ADDR, &radioSettings, sizeof(radioSettings));
+  timedCommit();
+  USBSerial.println("[Radio] ✓ Idle timeout saved");
+}
+
 ///////////////////////
 // ACCESS POINT MODE
 ///////////////////////
@@ -261,282 +907,338 @@ void startAPMode() {
   USBSerial.println("[AP] IP: 192.168.4.1");
   USBSerial.println("[AP] Connect to WiFi and visit http://192.168.4.1 to configure");
   
-  // LED indication: fast orange blink
-  for (int i = 0; i < 10; i++) {
+  // LED indication is drawn by drawAPIndicator() from loop() so the blink never blocks
+  apModeStartTime = millis();
+  
+  // Populate the network list in the background before the setup page asks for it
+  startNetworkScan();
+}
+
+// Kick off an asynchronous scan; results are collected by serviceNetworkScan()
+void startNetworkScan() {
+  if (scanInProgress) return;
+  
+  int16_t result = WiFi.scanNetworks(true);
+  if (result == WIFI_SCAN_FAILED) {
+    USBSerial.println("[AP] Network scan failed to start");
+    return;
+  }
+  scanInProgress = true;
+  USBSerial.println("[AP] Network scan started");
+}
+
+// Called by the server task after every poll: copies finished scan results into the cache
+void serviceNetworkScan() {
+  if (!scanInProgress) return;
+  
+  int16_t n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  
+  scanInProgress = false;
+  if (n < 0) {
+    USBSerial.println("[AP] Network scan failed");
+    return;
+  }
+  
+  scanResultCount = 0;
+  for (int i = 0; i < n && scanResultCount < MAX_SCAN_RESULTS; i++) {
+    // Read the driver's record directly (WiFi.SSID(i) would allocate a String)
+    wifi_ap_record_t* record = (wifi_ap_record_t*)WiFi.getScanInfoByIndex(i);
+    if (record == nullptr || record->ssid[0] == '\0') continue;  // Hidden network
+    
+    strncpy(scanResults[scanResultCount].ssid, (const char*)record->ssid, sizeof(scanResults[0].ssid) - 1);
+    scanResults[scanResultCount].ssid[sizeof(scanResults[0].ssid) - 1] = '\0';
+    scanResults[scanResultCount].rssi = record->rssi;
+    scanResultCount++;
+  }
+  WiFi.scanDelete();
+  scanResultTime = millis();
+  
+  USBSerial.print("[AP] Network scan complete: ");
+  USBSerial.print(scanResultCount);
+  USBSerial.println(" network(s)");
+}
+
+// Overlay the AP mode indicator on the current LED frame (non-blocking)
+void drawAPIndicator() {
+  if (!inAPMode) return;
+  
+  unsigned long elapsed = millis() - apModeStartTime;
+  if (elapsed < 2000) {
+    // Fast orange blink for the first 2 seconds
+    if ((elapsed / 100) % 2 == 0) {
+      fill_solid(leds, NUM_LEDS, CRGB(255, 165, 0));
+    } else {
+      FastLED.clear();
+    }
+  } else if (elapsed % 2000 < 100) {
+    // Then a short orange blip every 2 seconds while setup is active
     fill_solid(leds, NUM_LEDS, CRGB(255, 165, 0));
-    FastLED.show();
-    delay(100);
-    FastLED.clear();
-    FastLED.show();
-    delay(100);
   }
 }
 
+// Static UI (web/): gzipped at build time by tools/embed_web.py and served straight from
+// flash with Content-Encoding: gzip. The strong ETag lets a repeat load revalidate with a
+// 304 and no body; a firmware update with changed pages changes the ETag.
+struct AssetStats {
+  uint32_t sent;                         // Full (gzipped) responses
+  uint32_t notModified;                  // 304s
+  uint32_t bytes;                        // Body bytes sent
+  uint32_t totalUs;                      // Handler time
+  uint32_t maxUs;
+};
+AssetStats assetStats[WEB_ASSET_COUNT] = {};
+
+// Request headers the server keeps (it drops the rest)
+const char* COLLECTED_HEADERS[] = { "If-None-Match" };
+
+void serveAsset(uint8_t id) {
+  uint32_t start = micros();
+  const WebAsset& asset = WEB_ASSETS[id];
+  AssetStats& stats = assetStats[id];
+  
+  server.sendHeader("ETag", asset.etag);
+  server.sendHeader("Cache-Control", "no-cache");  // Cache, but revalidate every load
+  if (strstr(server.header("If-None-Match"), asset.etag)) {
+    server.send(304);
+    stats.notModified++;
+  } else {
+    server.sendHeader("Content-Encoding", "gzip");
+    server.send_P(200, asset.contentType, (PGM_P)asset.gzip, asset.gzipLength);
+    stats.sent++;
+    stats.bytes += asset.gzipLength;
+  }
+  
+  uint32_t elapsed = micros() - start;
+  stats.totalUs += elapsed;
+  if (elapsed > stats.maxUs) stats.maxUs = elapsed;
+}
+
+
 void setupAPWebServer() {
+  server.onRequest(noteWebRequest);
+  server.collectHeaders(COLLECTED_HEADERS, sizeof(COLLECTED_HEADERS) / sizeof(COLLECTED_HEADERS[0]));
+  
   // Root page - Setup UI
-  server.on("/", []() {
-    String html = R"=====(<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="UTF-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1.0">
-  <title>Afterfire Setup</title>
-  <style>
-    body {
-      font-family: 'Segoe UI', Arial, sans-serif;
-      background: linear-gradient(135deg, #1e1e1e 0%, #2d2d2d 100%);
-      color: #fff;
-      margin: 0;
-      padding: 20px;
-      text-align: center;
-    }
-    .container {
-      max-width: 600px;
-      margin: 50px auto;
-    }
-    h1 {
-      color: #ff6b35;
-      text-shadow: 0 0 10px rgba(255,107,53,0.5);
-      margin-bottom: 10px;
-    }
-    .subtitle {
-      color: #aaa;
-      margin-bottom: 30px;
-    }
-    .card {
-      background: rgba(255,255,255,0.1);
-      border-radius: 10px;
-      padding: 30px;
-      backdrop-filter: blur(10px);
-      border: 1px solid rgba(255,255,255,0.2);
-      text-align: left;
-    }
-    .form-group {
-      margin-bottom: 20px;
-    }
-    label {
-      display: block;
-      margin-bottom: 8px;
-      color: #aaa;
-      font-size: 0.9em;
-    }
-    input[type="text"], input[type="password"], select {
-      width: 100%;
-      padding: 12px;
-      box-sizing: border-box;
-      background: rgba(255,255,255,0.1);
-      border: 1px solid rgba(255,255,255,0.3);
-      border-radius: 5px;
-      color: #fff;
-      font-size: 16px;
-    }
-    input[type="text"]:focus, input[type="password"]:focus, select:focus {
-      outline: none;
-      border-color: #ff6b35;
-      background: rgba(255,107,53,0.1);
-    }
-    select {
-      cursor: pointer;
-    }
-    option {
-      background: #2d2d2d;
-      color: #fff;
-    }
-    button {
-      width: 100%;
-      padding: 14px;
-      background: #ff6b35;
-      color: white;
-      border: none;
-      border-radius: 5px;
-      cursor: pointer;
-      font-size: 16px;
-      font-weight: bold;
-      margin-top: 10px;
-    }
-    button:hover {
-      background: #ff8555;
-    }
-    button:disabled {
-      background: #555;
-      cursor: not-allowed;
-    }
-    .loading {
-      display: none;
-      text-align: center;
-      color: #ff6b35;
-    }
-    .spinner {
-      border: 3px solid rgba(255,255,255,0.3);
-      border-top: 3px solid #ff6b35;
-      border-radius: 50%;
-      width: 40px;
-      height: 40px;
-      animation: spin 1s linear infinite;
-      margin: 20px auto;
-    }
-    @keyframes spin {
-      0% { transform: rotate(0deg); }
-      100% { transform: rotate(360deg); }
-    }
-    .footer {
-      margin-top: 20px;
-      font-size: 0.85em;
-      color: #666;
-    }
-  </style>
-</head>
-<body>
-  <div class="container">
-    <h1>🔥 Afterfire Setup</h1>
-    <p class="subtitle">First-time configuration</p>
-    
-    <div class="card">
-      <div id="setupForm">
-        <div class="form-group">
-          <label for="networkSelect">Available WiFi Networks:</label>
-          <select id="networkSelect">
-            <option value="">Scanning networks...</option>
-          </select>
-        </div>
-        
-        <div class="form-group">
-          <label for="ssid">Network Name (SSID):</label>
-          <input type="text" id="ssid" placeholder="Enter manually if not in list">
-        </div>
-        
-        <div class="form-group">
-          <label for="password">Password:</label>
-          <input type="password" id="password" placeholder="WiFi password">
-        </div>
-        
-        <button onclick="saveCredentials()">Connect & Save</button>
-        <button onclick="location.reload()" style="background: #666; margin-top: 5px;">Rescan</button>
-      </div>
-      
-      <div class="loading" id="loading">
-        <p>Connecting to WiFi and saving settings...</p>
-        <div class="spinner"></div>
-        <p>Device will reboot in a moment...</p>
-      </div>
-    </div>
-    
-    <div class="footer">
-      <p>Connected to: <strong>afterfire-setup</strong> (192.168.4.1)</p>
-    </div>
-  </div>
-
-  <script>
-    function scanNetworks() {
-      document.getElementById('networkSelect').innerHTML = '<option value="">Scanning...</option>';
-      fetch('/api/scan-networks')
-        .then(r => r.json())
-        .then(data => {
-          const select = document.getElementById('networkSelect');
-          select.innerHTML = '<option value="">-- Select network --</option>';
-          data.networks.forEach(net => {
-            const option = document.createElement('option');
-            option.value = net.ssid;
-            option.text = net.ssid + ' (' + net.rssi + ' dBm)';
-            select.appendChild(option);
-          });
-        })
-        .catch(err => {
-          document.getElementById('networkSelect').innerHTML = '<option value="">Scan failed</option>';
-          console.error(err);
-        });
-    }
-    
-    function saveCredentials() {
-      const select = document.getElementById('networkSelect');
-      let ssid = document.getElementById('ssid').value;
-      const password = document.getElementById('password').value;
-      
-      if (select.value) {
-        ssid = select.value;
-      }
-      
-      if (!ssid || !password) {
-        alert('Please enter both SSID and password');
-        return;
-      }
-      
-      document.getElementById('setupForm').style.display = 'none';
-      document.getElementById('loading').style.display = 'block';
-      
-      fetch('/api/wifi/save', {
-        method: 'POST',
-        headers: { 'Content-Type': 'application/json' },
-        body: JSON.stringify({ ssid: ssid, password: password })
-      })
-      .then(r => r.json())
-      .then(data => {
-        if (data.success) {
-          console.log('Settings saved, rebooting...');
-          setTimeout(() => location.reload(), 3000);
-        } else {
-          alert('Failed to save: ' + (data.error || 'Unknown error'));
-          document.getElementById('setupForm').style.display = 'block';
-          document.getElementById('loading').style.display = 'none';
-        }
-      })
-      .catch(err => {
-        alert('Error: ' + err);
-        document.getElementById('setupForm').style.display = 'block';
-        document.getElementById('loading').style.display = 'none';
-      });
-    }
-    
-    // Scan on load
-    scanNetworks();
-  </script>
-</body>
-</html>)=====";
-    server.send(200, "text/html", html);
-  });
+  server.on("/", []() { serveAsset(ASSET_SETUP_HTML); });
+  server.on("/common.css", []() { serveAsset(ASSET_COMMON_CSS); });
   
-  // Scan WiFi networks
+  // Scan WiFi networks - serves the cached list instantly, refreshing it in the background
   server.on("/api/scan-networks", []() {
-    int n = WiFi.scanNetworks();
-    String json = "{\"networks\":[";
-    for (int i = 0; i < n; i++) {
-      if (i > 0) json += ",";
-      json += "{\"ssid\":\"" + WiFi.SSID(i) + "\",\"rssi\":" + String(WiFi.RSSI(i)) + "}";
+    bool stale = scanResultTime == 0 || millis() - scanResultTime > SCAN_CACHE_MAX_AGE;
+    if (stale || server.hasArg("refresh")) {
+      startNetworkScan();
     }
-    json += "]}";
-    server.send(200, "application/json", json);
+    
+    sendJson(200, writeScanJson);
   });
   
   // Save WiFi credentials
-  server.on("/api/wifi/save", HTTP_POST, []() {
-    String body = server.arg("plain");
+  server.on("/api/wifi/save", HTTP_METHOD_POST, []() {
+    const char* body = server.arg("plain");
     USBSerial.print("[AP] WiFi config received: ");
     USBSerial.println(body);
     
-    // Parse JSON (simple parsing without library to save memory)
-    int ssidStart = body.indexOf("\"ssid\":\"") + 8;
-    int ssidEnd = body.indexOf("\"", ssidStart);
-    String newSSID = body.substring(ssidStart, ssidEnd);
+    // One save per boot: the staged buffers belong to the loop once handed over
+    if (wifiSaveStaged) {
+      server.send_P(503, "application/json", "{\"success\":false,\"error\":\"Already saving\"}");
+      return;
+    }
     
-    int pwdStart = body.indexOf("\"password\":\"") + 12;
-    int pwdEnd = body.indexOf("\"", pwdStart);
-    String newPwd = body.substring(pwdStart, pwdEnd);
+    // Parse JSON straight into the staging buffers (simple parsing without library to save memory)
+    bool valid = extractJsonString(body, "ssid", stagedSSID, sizeof(stagedSSID)) &&
+                 extractJsonString(body, "password", stagedPassword, sizeof(stagedPassword));
     
-    if (newSSID.length() > 0 && newPwd.length() > 0) {
-      strncpy(settings.ssid, newSSID.c_str(), sizeof(settings.ssid) - 1);
-      strncpy(settings.password, newPwd.c_str(), sizeof(settings.password) - 1);
-      saveSettings();
-      
-      USBSerial.println("[AP] Settings saved, rebooting...");
-      server.send(200, "application/json", "{\"success\":true}");
-      delay(1000);
-      ESP.restart();
+    if (valid && stagedSSID[0] != '\0' && stagedPassword[0] != '\0') {
+      // The loop saves them (the only EEPROM writer) and then the server task restarts
+      wifiSaveStaged = true;
+      if (!pushCommand(CMD_SAVE_WIFI)) {
+        wifiSaveStaged = false;
+        server.send_P(503, "application/json", "{\"success\":false,\"error\":\"Busy\"}");
+        return;
+      }
+      server.send_P(200, "application/json", "{\"success\":true}");
     } else {
-      server.send(400, "application/json", "{\"success\":false,\"error\":\"Invalid credentials\"}");
+      server.send_P(400, "application/json", "{\"success\":false,\"error\":\"Invalid credentials\"}");
     }
   });
 }
 
+///////////////////////
+// WIFI CONNECTION
+///////////////////////
+
+// Start a station connection, using the cached BSSID/channel when allowed
+void beginWiFiConnect(bool allowFast) {
+  wifiFastAttempt = allowFast && wifiCache.version == WIFI_CACHE_VERSION;
+  
+  WiFi.disconnect();
+  if (wifiFastAttempt) {
+    // BSSID + channel skip the scan; the address still comes from DHCP
+    WiFi.begin(settings.ssid, settings.password, wifiCache.channel, wifiCache.bssid);
+    wifiConnectTimeout = millis() + WIFI_FAST_CONNECT_TIMEOUT;
+  } else {
+    WiFi.begin(settings.ssid, settings.password);
+    wifiConnectTimeout = millis() + WIFI_CONNECT_TIMEOUT;
+  }
+  
+  wifiAttemptStart = millis();
+  wifiState = WIFI_STATE_CONNECTING;
+}
+
+// Non-blocking connection state machine; call every loop while in station mode
+void serviceWiFi() {
+  switch (wifiState) {
+    case WIFI_STATE_IDLE:
+      break;
+      
+    case WIFI_STATE_CONNECTING:
+      if (WiFi.status() == WL_CONNECTED) {
+        USBSerial.print("[WiFi] Connected in ");
+        USBSerial.print(millis() - wifiAttemptStart);
+        USBSerial.print(" ms");
+        USBSerial.println(wifiFastAttempt ? " (fast connect)" : "");
+        
+        saveWiFiCache();
+        wifiBackoffDelay = 0;
+        wifiState = WIFI_STATE_CONNECTED;
+      } else if ((long)(millis() - wifiConnectTimeout) >= 0) {
+        if (wifiFastAttempt) {
+          // Cached AP may have moved channel - fall back to a full scan
+          // (the cache is refreshed if the full connect lands somewhere else)
+          USBSerial.println("[WiFi] Fast connect failed, trying full connect");
+          beginWiFiConnect(false);
+        } else {
+          wifiBackoffDelay = constrain(wifiBackoffDelay * 2, WIFI_BACKOFF_MIN, WIFI_BACKOFF_MAX);
+          USBSerial.print("[WiFi] Connect failed, retrying in ");
+          USBSerial.print(wifiBackoffDelay);
+          USBSerial.println(" ms");
+          WiFi.disconnect();
+          wifiBackoffStart = millis();
+          wifiState = WIFI_STATE_BACKOFF;
+        }
+      }
+      break;
+      
+    case WIFI_STATE_CONNECTED:
+      if (WiFi.status() != WL_CONNECTED) {
+        USBSerial.println("[WiFi] Connection lost");
+        wifiReconnectCount++;
+        wifiBackoffDelay = 0;
+        beginWiFiConnect(true);
+      }
+      break;
+      
+    case WIFI_STATE_BACKOFF:
+      if (millis() - wifiBackoffStart >= wifiBackoffDelay) {
+        USBSerial.println("[WiFi] Reconnecting...");
+        beginWiFiConnect(true);
+      }
+      break;
+  }
+}
+
+///////////////////////
+// RADIO-OFF MODE
+///////////////////////
+
+// Server hook, runs before every request is routed: counts it as activity and records
+// the handler for the watchdog report
+void noteWebRequest() {
+  lastWebRequestTime = millis();
+  recordHandler(server.uri());
+}
+
+// Loop task. The WiFi teardown itself is left to the server task (radioTeardown()), which
+// may be inside a handler or sending a UDP datagram right now.
+void radioOff(const char* reason) {
+  USBSerial.printf("[Radio] Off (%s) - hold full brake for %d s to turn it back on\n", reason, GESTURE_HOLD_MS / 1000);
+  ArduinoOTA.end();
+  radioTeardownPending = true;
+  wifiState = WIFI_STATE_IDLE;
+  radioOn = false;
+  timerCancel(housekeepingTimers, TIMER_RADIO_OFF);
+  radioServicesPending = false;
+  radioStateSince = millis();
+}
+
+void radioOnAgain() {
+  USBSerial.println("[Radio] On - reconnecting");
+  WiFi.mode(WIFI_STA);
+  wifiBackoffDelay = 0;
+  beginWiFiConnect(true);
+  radioOn = true;
+  radioServicesPending = true;
+  radioStateSince = millis();
+  lastWebRequestTime = millis();
+}
+
+// Server task, between polls: nothing is using the interface, so close everything that
+// does - the UDP stream, the listener and every connection - and only then stop WiFi
+void radioTeardown() {
+  stopUdpStream();
+  server.stop();
+  server.poll(0);                        // Applies the stop: listener and connections closed
+  WiFi.disconnect(true);
+  WiFi.mode(WIFI_OFF);
+  radioTeardownPending = false;
+  USBSerial.println("[Radio] WiFi stopped");
+}
+
+// Housekeeping timer for /api/radio/off (armed by CMD_RADIO_OFF), gives the response time to go out
+void radioOffRequested() {
+  if (radioOn) radioOff("requested");
+}
+
+// Idle timeout and wake requests; call every loop in station mode
+void serviceRadio() {
+  if (radioOn) {
+    if (radioServicesPending && wifiState == WIFI_STATE_CONNECTED) {
+      server.begin();
+      ArduinoOTA.begin();
+      radioServicesPending = false;
+      USBSerial.print("[Radio] Web server and OTA back at ");
+      USBSerial.println(WiFi.localIP());
+    }
+    
+    if (radioIdleOffMinutes > 0 && millis() - lastWebRequestTime >= radioIdleOffMinutes * 60000UL) {
+      radioOff("idle");
+    }
+  } else if (radioWakeRequested && !radioTeardownPending) {  // WiFi must be fully stopped first
+    radioWakeRequested = false;
+    radioOnAgain();
+  }
+  
+  // Persist a changed idle timeout between effects, like the main settings
+  if (radioIdleOffMinutes != radioSettings.idleOffMinutes && !fastFrames && !burstActive) {
+    saveRadioSettings();
+  }
+}
+
+// Frame pipeline: receiver period jitter and edge-to-frame latency, split by radio state
+void sampleRadioJitter(const CaptureState& capture, uint32_t frameStart) {
+  static uint32_t lastFrame = 0;
+  static uint32_t lastPeriod = 0;
+  if (capture.frame == lastFrame) return;  // No new pulse since the last frame
+  
+  RadioStateStats& stats = radioStats[radioOn ? 0 : 1];
+  bool clean = !(capture.flags & (CAPTURE_SLEEP_DELAYED | CAPTURE_MISSED_EDGES | CAPTURE_OUT_OF_RANGE));
+  if (clean) {
+    if (capture.frame == lastFrame + 1 && lastPeriod > 0) {
+      uint32_t jitter = abs((int32_t)capture.period - (int32_t)lastPeriod);
+      stats.periods++;
+      stats.periodJitterSumUs += jitter;
+      if (jitter > stats.periodJitterMaxUs) stats.periodJitterMaxUs = jitter;
+    }
+    uint32_t latency = frameStart - capture.fallTime;
+    stats.latencyCount++;
+    stats.latencySumUs += latency;
+    if (latency > stats.latencyMaxUs) stats.latencyMaxUs = latency;
+  }
+  lastFrame = capture.frame;
+  lastPeriod = clean ? capture.period : 0;
+}
+
 ///////////////////////
 // BOOT LED SEQUENCE
 ///////////////////////
@@ -597,50 +1299,1085 @@ void bootSequence() {
 // INTERRUPT
 ///////////////////////
 
-void IRAM_ATTR readThrottle() {
-  if (digitalRead(THROTTLE_PIN)) {
-    pulseStart = micros();
+// Runs from IRAM through the IDF GPIO ISR service (ESP_INTR_FLAG_IRAM) and touches only
+// DRAM state, IRAM functions and inline register reads, so edges are still captured while
+// the flash cache is disabled by EEPROM commits and OTA writes
+void IRAM_ATTR readThrottle(void*) {
+  uint32_t now = (uint32_t)esp_timer_get_time();
+  if (gpio_ll_get_level(&GPIO, (gpio_num_t)THROTTLE_PIN)) {
+    uint32_t period = now - isrRiseTime;
+    isrPeriod = period;
+    isrRiseTime = now;
+    
+    // A period spanning several receiver frames means edges were missed
+    if (period >= PULSE_SIGNAL_LOST_US) {
+      nominalPulsePeriod = 0;
+    } else if (nominalPulsePeriod == 0) {
+      nominalPulsePeriod = period;
+    } else if (period > nominalPulsePeriod + nominalPulsePeriod / 2) {
+      isrLostPulses += (period + nominalPulsePeriod / 2) / nominalPulsePeriod - 1;
+      isrMissedEdges = true;
+    } else {
+      nominalPulsePeriod = (nominalPulsePeriod * 7 + period) / 8;
+    }
+    
+    if (sleepWindowOpen) {
+      // Woke from light sleep on this edge: the timestamp is late by the wake latency.
+      // Put the pin back to edge interrupts (the wake source uses level mode).
+      isrRoseInSleepWindow = true;
+      gpio_ll_wakeup_disable(&GPIO, (gpio_num_t)THROTTLE_PIN);
+      gpio_ll_set_intr_type(&GPIO, (gpio_num_t)THROTTLE_PIN, GPIO_INTR_ANYEDGE);
+    } else {
+      isrRoseInSleepWindow = false;
+    }
   } else {
-    pulseWidth = micros() - pulseStart;
+    uint32_t width = now - isrRiseTime;
+    uint8_t flags = 0;
+    if (isrRoseInSleepWindow) flags |= CAPTURE_SLEEP_DELAYED;
+    if (isrMissedEdges) flags |= CAPTURE_MISSED_EDGES;
+    if (width < 500 || width > 2500) flags |= CAPTURE_OUT_OF_RANGE;
+    isrMissedEdges = false;
+    
+    // Seqlock write: odd sequence while the fields change
+    uint32_t seq = captureSeq.load(std::memory_order_relaxed);
+    captureSeq.store(seq + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    // Only a trustworthy width replaces the last good one (out-of-range ones would also
+    // not fit the uint16_t)
+    if (!(flags & (CAPTURE_SLEEP_DELAYED | CAPTURE_OUT_OF_RANGE))) {
+      captureState.width = width;
+    }
+    captureState.flags = flags;
+    captureState.riseTime = isrRiseTime;
+    captureState.fallTime = now;
+    captureState.period = isrPeriod;
+    captureState.frame++;
+    captureState.lostPulses = isrLostPulses;
+    captureSeq.store(seq + 2, std::memory_order_release);
+    
+    // Wake the frame pipeline as soon as a fresh pulse is available
+    if (loopTaskHandle != nullptr) {
+      BaseType_t woken = pdFALSE;
+      vTaskNotifyGiveFromISR(loopTaskHandle, &woken);
+      if (woken) portYIELD_FROM_ISR();
+    }
   }
 }
 
+// Consistent copy of the latest capture; retries if the ISR published mid-read
+CaptureState readCapture() {
+  CaptureState snapshot;
+  uint32_t before, after;
+  do {
+    before = captureSeq.load(std::memory_order_acquire);
+    snapshot = captureState;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = captureSeq.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+  return snapshot;
+}
+
 ///////////////////////
-// SETUP
+// FRAME PROFILING
 ///////////////////////
 
-void setup() {
-  // Initialize Serial for debugging
-  USBSerial.begin(115200);
-  delay(1000); // Wait for serial connection
-  
-  USBSerial.println("\n\n==================================");
-  USBSerial.println("ESP32-S3 Afterfire Effect v1.0");
-  USBSerial.println("WaveShare ESP32-S3-Zero");
-  USBSerial.println("==================================");
-  USBSerial.print("Chip Model: ");
-  USBSerial.println(ESP.getChipModel());
-  USBSerial.print("Chip Revision: ");
-  USBSerial.println(ESP.getChipRevision());
-  USBSerial.print("CPU Frequency: ");
-  USBSerial.print(ESP.getCpuFreqMHz());
-  USBSerial.println(" MHz");
-  USBSerial.println("==================================");
+// Bucket index for a cycle count: exact below 4, then 4 linear steps per power of two
+static inline uint32_t profileBucket(uint32_t cycles) {
+  if (cycles < 4) return cycles;
+  uint32_t msb = 31 - __builtin_clz(cycles);
+  uint32_t sub = (cycles >> (msb - 2)) & 3;
+  return (msb - 1) * 4 + sub;
+}
+
+// Largest cycle count that falls into a bucket
+static uint32_t profileBucketUpper(uint32_t bucket) {
+  if (bucket < 4) return bucket;
+  uint32_t msb = bucket / 4 + 1;
+  uint32_t sub = bucket % 4;
+  return ((4 + sub) << (msb - 2)) + (1u << (msb - 2)) - 1;
+}
+
+// Cycle counts as if run at the full clock. DFS drops the clock to 80 MHz when idle, so
+// counts are scaled by the clock they were taken at before they share a histogram
+#define PROFILE_REF_MHZ CPU_FREQ_ACTIVE_MHZ
+
+static inline uint32_t normaliseCycles(uint32_t cycles) {
+  uint32_t mhz = ESP.getCpuFreqMHz();
+  return mhz == PROFILE_REF_MHZ ? cycles : (uint32_t)((uint64_t)cycles * PROFILE_REF_MHZ / mhz);
+}
+
+// Called from the StageTimer destructor - well under a microsecond, safe to leave enabled
+static inline void recordStage(uint8_t stage, uint32_t cycles) {
+  cycles = normaliseCycles(cycles);
+  StageProfile& p = stageProfiles[stage];
+  p.buckets[profileBucket(cycles)]++;
+  p.count++;
+  if (cycles > p.maxCycles) p.maxCycles = cycles;
+  frameStageCycles[stage] += cycles;
+}
+
+void resetStageProfiles() {
+  memset(stageProfiles, 0, sizeof(stageProfiles));
+}
+
+// Cycle count at or below which the given fraction of samples fall (bucket upper bound)
+uint32_t stagePercentile(const StageProfile& p, float fraction) {
+  if (p.count == 0) return 0;
+  uint32_t target = (uint32_t)ceilf(p.count * fraction);
+  uint32_t seen = 0;
+  for (uint32_t i = 0; i < PROFILE_BUCKETS; i++) {
+    seen += p.buckets[i];
+    if (seen >= target) return min(profileBucketUpper(i), p.maxCycles);
+  }
+  return p.maxCycles;
+}
+
+// Scoped cycle-counter timer: records the enclosing block into a stage histogram
+struct StageTimer {
+  uint8_t stage;
+  uint8_t parent;
+  uint32_t start;
+  StageTimer(uint8_t s) : stage(s), parent(currentStage), start(ESP.getCycleCount()) { currentStage = s; }
+  ~StageTimer() {
+    recordStage(stage, ESP.getCycleCount() - start);
+    currentStage = parent;
+  }
+};
+
+///////////////////////
+// FRAME DEADLINE & WATCHDOG
+///////////////////////
+
+// Called at the end of each loop with the loop's total work time (normalised cycles)
+void checkFrameDeadline(uint32_t cycles) {
+  uint32_t cyclesPerUs = PROFILE_REF_MHZ;
+  uint32_t durationUs = cycles / cyclesPerUs;
+  uint32_t deadlineUs = (fastFrames ? FRAME_PERIOD_FAST_MS : FRAME_PERIOD_STEADY_MS) * 1000;
   
-  // Initialize EEPROM
-  EEPROM.begin(EEPROM_SIZE);
-  loadSettings();
+  if (durationUs > deadlineUs) {
+    // Blame the most expensive leaf stage (STAGE_FRAME is the sum of its sub-stages, and
+    // housekeeping includes the debug line)
+    frameStageCycles[STAGE_HOUSEKEEPING] -= min(frameStageCycles[STAGE_HOUSEKEEPING], frameStageCycles[STAGE_DEBUG]);
+    uint8_t worst = 0;
+    for (uint8_t i = 1; i < STAGE_COUNT; i++) {
+      if (i != STAGE_FRAME && frameStageCycles[i] > frameStageCycles[worst]) worst = i;
+    }
+    
+    DeadlineMiss& miss = deadlineLog[deadlineMissCount % DEADLINE_LOG_SIZE];
+    miss.timeMs = millis();
+    miss.deadlineUs = deadlineUs;
+    miss.durationUs = durationUs;
+    miss.stage = worst;
+    miss.stageUs = frameStageCycles[worst] / cyclesPerUs;
+    deadlineMissCount++;
+  }
   
-  // Initialize throttle input
-  pinMode(THROTTLE_PIN, INPUT);
-  attachInterrupt(digitalPinToInterrupt(THROTTLE_PIN), readThrottle, CHANGE);
-  USBSerial.println("Throttle interrupt attached to pin 2");
+  memset(frameStageCycles, 0, sizeof(frameStageCycles));
+}
 
-  // Initialize FastLED
-  FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS);
-  FastLED.setBrightness(MAX_BRIGHTNESS);
-  FastLED.clear();
-  FastLED.show();
+// Runs inside the task watchdog interrupt just before the panic reset
+extern "C" void esp_task_wdt_isr_user_handler(void) {
+  wdtStage = currentStage;
+  wdtStageMagic = WDT_STAGE_MAGIC;
+}
+
+// Report which stage (and which web handler, if one was running) hung if the previous
+// reset came from the task watchdog
+void checkWatchdogReset() {
+  if (esp_reset_reason() == ESP_RST_TASK_WDT && wdtStageMagic == WDT_STAGE_MAGIC) {
+    lastResetStage = wdtStage < STAGE_COUNT ? wdtStage : -1;
+    USBSerial.print("[WDT] Previous reset: task watchdog, stage: ");
+    USBSerial.println(lastResetStage >= 0 ? STAGE_NAMES[lastResetStage] : "unknown");
+    wdtHandler[WDT_HANDLER_LENGTH - 1] = '\0';
+    if (wdtHandler[0] != '\0') {
+      memcpy(lastResetHandler, wdtHandler, WDT_HANDLER_LENGTH);
+      USBSerial.printf("[WDT] Web handler running: %s\n", lastResetHandler);
+    }
+  }
+  wdtStageMagic = 0;
+  wdtHandler[0] = '\0';
+}
+
+// Server task: the handler about to run, kept across a watchdog reset. Only characters
+// that are safe to put in JSON unescaped are kept.
+void recordHandler(const char* uri) {
+  size_t i = 0;
+  for (; uri[i] != '\0' && i < WDT_HANDLER_LENGTH - 1; i++) {
+    char c = uri[i];
+    wdtHandler[i] = (c > ' ' && c < 0x7F && c != '"' && c != '\\') ? c : '_';
+  }
+  wdtHandler[i] = '\0';
+}
+
+// Server task, while flushBody() waits on a slow client
+void feedHttpWatchdog() {
+  esp_task_wdt_reset();
+}
+
+// Subscribe the loop task (and the server task, if running) to the task watchdog once
+// setup() has finished blocking
+void startFrameWatchdog() {
+  esp_task_wdt_init(WDT_TIMEOUT_S, true);
+  esp_task_wdt_add(NULL);
+  if (httpTaskHandle != nullptr) esp_task_wdt_add(httpTaskHandle);
+  USBSerial.print("[WDT] Loop and web server watchdog armed (");
+  USBSerial.print(WDT_TIMEOUT_S);
+  USBSerial.println(" s)");
+}
+
+///////////////////////
+// FRAME-BUDGET GOVERNOR
+///////////////////////
+
+float decayingPeak(float estimate, float sample) {
+  return sample >= estimate ? sample : estimate - (estimate - sample) / GOVERNOR_COST_DECAY;
+}
+
+// Predicted frame time at a tier: the untiered part plus every tiered effect at that tier
+float predictFrameUs(uint8_t tier) {
+  float total = frameBaseCostUs;
+  for (const EffectCost& effect : effectCosts) total += effect.costUs[tier];
+  return total;
+}
+
+// Before each frame: the highest detail whose predicted cost fits the rest of the deadline,
+// counted from when the frame became due (work left over from the last loop makes it late).
+// A tier never tried yet predicts as free, so the governor learns it the first time it's needed
+void chooseDetailTier() {
+  float usedUs = (long)(micros() - frameDueUs) > 0 ? (float)(micros() - frameDueUs) : 0;
+  float deadlineUs = (fastFrames ? FRAME_PERIOD_FAST_MS : FRAME_PERIOD_STEADY_MS) * 1000;
+  float availableUs = deadlineUs - usedUs - GOVERNOR_MARGIN_US;
+  
+  uint8_t tier = TIER_FULL;
+  while (tier < TIER_MINIMAL && predictFrameUs(tier) > availableUs) tier++;
+  
+  // Drop detail at once; restore it only after a quiet spell so effects don't visibly flap
+  if (tier > TIER_FULL) tierPressureTime = millis();
+  if (tier > frameTier || millis() - tierPressureTime >= GOVERNOR_RESTORE_HOLD_MS) {
+    frameTier = (DetailTier)tier;
+  }
+  tierFrames[frameTier]++;
+}
+
+// After each frame: what the tiered effects and the rest of the frame cost at this tier
+void learnFrameCosts() {
+  uint32_t cyclesPerUs = PROFILE_REF_MHZ;
+  uint32_t tieredCycles = 0;
+  for (EffectCost& effect : effectCosts) {
+    uint32_t cycles = frameStageCycles[effect.stage];
+    tieredCycles += cycles;
+    effect.costUs[frameTier] = decayingPeak(effect.costUs[frameTier], (float)cycles / cyclesPerUs);
+  }
+  uint32_t restCycles = frameStageCycles[STAGE_FRAME] > tieredCycles ? frameStageCycles[STAGE_FRAME] - tieredCycles : 0;
+  frameBaseCostUs = decayingPeak(frameBaseCostUs, (float)restCycles / cyclesPerUs);
+}
+
+///////////////////////
+// CONFIG SNAPSHOTS
+///////////////////////
+
+// Boot only: install the first snapshot before any reader runs
+void publishInitialConfig(const RenderConfig& initial) {
+  configSlots[0] = initial;
+  activeConfig.store(&configSlots[0]);
+  config = &configSlots[0];
+}
+
+// Reader side: the returned snapshot stays valid until the reader's next quiescent point
+const RenderConfig* configAcquire() {
+  return activeConfig.load();
+}
+
+// Reader holds no snapshot pointer from here on
+void configQuiescent(ConfigReader reader) {
+  configReaderSeen[reader].store(configGeneration.load());
+}
+
+// A slot that is neither active nor possibly still held by a reader (writers only)
+RenderConfig* findFreeConfigSlot(const RenderConfig* active) {
+  uint32_t oldestSeen = UINT32_MAX;
+  for (int r = 0; r < CONFIG_READER_COUNT; r++) {
+    oldestSeen = min<uint32_t>(oldestSeen, configReaderSeen[r].load());
+  }
+  for (int i = 0; i < CONFIG_SLOTS; i++) {
+    if (&configSlots[i] != active && configRetiredAt[i] <= oldestSeen) return &configSlots[i];
+  }
+  return nullptr;
+}
+
+// Writer side: copy the active snapshot, apply edit() to the copy and publish it.
+// Returns false (nothing changed) if every spare slot is still held by a reader.
+template <typename Edit>
+bool updateConfig(Edit edit) {
+  bool published = false;
+  portENTER_CRITICAL(&configWriteMux);
+  RenderConfig* active = activeConfig.load();
+  RenderConfig* next = findFreeConfigSlot(active);
+  if (next != nullptr) {
+    *next = *active;
+    edit(*next);
+    activeConfig.store(next);
+    configRetiredAt[active - configSlots] = configGeneration.fetch_add(1) + 1;
+    published = true;
+  }
+  portEXIT_CRITICAL(&configWriteMux);
+  return published;
+}
+
+///////////////////////
+// COMMAND QUEUE
+///////////////////////
+
+// Producer side (web handlers, on the server task). Returns false if the queue is full.
+bool pushCommand(CommandType type, uint8_t param, int16_t a, int16_t b) {
+  uint32_t head = commandHead.load(std::memory_order_relaxed);
+  uint32_t tail = commandTail.load(std::memory_order_acquire);
+  
+  if (head - tail >= COMMAND_QUEUE_SIZE) {
+    commandsDropped++;
+    return false;
+  }
+  
+  Command& cmd = commandQueue[head & (COMMAND_QUEUE_SIZE - 1)];
+  cmd.type = type;
+  cmd.param = param;
+  cmd.a = a;
+  cmd.b = b;
+  
+  // Publish the slot only after it is fully written, then end the loop's frame wait
+  commandHead.store(head + 1, std::memory_order_release);
+  if (loopTaskHandle != nullptr) xTaskNotifyGive(loopTaskHandle);
+  return true;
+}
+
+// Loop task: true while commands are queued but not yet applied
+bool commandsPending() {
+  return commandHead.load(std::memory_order_acquire) != commandTail.load(std::memory_order_relaxed);
+}
+
+void applyCommand(const Command& cmd) {
+  switch (cmd.type) {
+    case CMD_TRIGGER_BURST:
+      startBurst(cmd.param, cmd.a, cmd.b);
+      break;
+      
+    case CMD_CALIBRATE_START:
+      USBSerial.println("\n[Cal] === STARTING MANUAL CALIBRATION ===");
+      USBSerial.println("[Cal] Step 1: Waiting for NEUTRAL capture...");
+      calibrationStep = CAL_NEUTRAL;
+      timerCancel(effectTimers, TIMER_CAL_FLASH);
+      break;
+      
+    case CMD_CALIBRATE_CAPTURE:
+      if (cmd.param != calibrationStep) break;  // Stale capture for a step we already left
+      
+      if (calibrationStep == CAL_NEUTRAL) {
+        uint16_t neutral = cmd.a;
+        if (!updateConfig([neutral](RenderConfig& c) {
+          c.neutralPulse = neutral;
+          c.neutralMin = neutral - 25;
+          c.neutralMax = neutral + 25;
+        })) {
+          USBSerial.println("[Cal] Config busy - capture again");
+          break;
+        }
+        calibratedNeutral = neutral;
+        USBSerial.print("[Cal] ✓ Neutral captured: "); USBSerial.println(calibratedNeutral);
+        USBSerial.println("[Cal] Step 2: Waiting for THROTTLE capture...");
+        calibrationStep = CAL_THROTTLE;
+      } else if (calibrationStep == CAL_THROTTLE) {
+        uint16_t throttle = cmd.a;
+        if (!updateConfig([throttle](RenderConfig& c) { c.maxPulse = throttle; })) {
+          USBSerial.println("[Cal] Config busy - capture again");
+          break;
+        }
+        calibratedThrottle = throttle;
+        USBSerial.print("[Cal] ✓ Throttle captured: "); USBSerial.println(calibratedThrottle);
+        USBSerial.println("[Cal] Step 3: Waiting for BRAKE capture...");
+        calibrationStep = CAL_BRAKE;
+      } else if (calibrationStep == CAL_BRAKE) {
+        uint16_t brake = cmd.a;
+        if (!updateConfig([brake](RenderConfig& c) { c.minPulse = brake; })) {
+          USBSerial.println("[Cal] Config busy - capture again");
+          break;
+        }
+        calibratedBrake = brake;
+        USBSerial.print("[Cal] ✓ Brake captured: "); USBSerial.println(calibratedBrake);
+        
+        const RenderConfig& cal = *configAcquire();
+        USBSerial.println("\n[Cal] === CALIBRATION COMPLETE ===");
+        USBSerial.print("Neutral: "); USBSerial.print(cal.neutralPulse);
+        USBSerial.print(" (range: "); USBSerial.print(cal.neutralMin);
+        USBSerial.print("-"); USBSerial.print(cal.neutralMax); USBSerial.println(")");
+        USBSerial.print("Full Throttle: "); USBSerial.println(cal.maxPulse);
+        USBSerial.print("Full Brake: "); USBSerial.println(cal.minPulse);
+        
+        calibrationStep = CAL_COMPLETE;
+      }
+      break;
+      
+    case CMD_RESET_METRICS:
+      resetStageProfiles();
+      memset(tierFrames, 0, sizeof(tierFrames));
+      memset(&edgeToOutput, 0, sizeof(edgeToOutput));
+      for (CoreLoad& core : coreLoad) core.peakLoad = 0;
+      break;
+      
+    case CMD_RADIO_OFF:
+      scheduleHousekeepingTimer(TIMER_RADIO_OFF, RADIO_OFF_DELAY_MS);
+      break;
+      
+    case CMD_SAVE_WIFI:
+      strncpy(settings.ssid, stagedSSID, sizeof(settings.ssid) - 1);
+      strncpy(settings.password, stagedPassword, sizeof(settings.password) - 1);
+      wifiSavePending = true;            // Written in housekeeping, outside the frame
+      break;
+  }
+}
+
+// Consumer side: the frame pipeline drains all pending commands once per frame.
+// Returns the number of commands applied.
+uint32_t applyCommands() {
+  uint32_t tail = commandTail.load(std::memory_order_relaxed);
+  uint32_t head = commandHead.load(std::memory_order_acquire);
+  uint32_t applied = head - tail;
+  
+  while (tail != head) {
+    applyCommand(commandQueue[tail & (COMMAND_QUEUE_SIZE - 1)]);
+    tail++;
+  }
+  
+  // Hand the slots back to the producer
+  commandTail.store(tail, std::memory_order_release);
+  return applied;
+}
+
+///////////////////////
+// POWER MANAGEMENT
+///////////////////////
+
+// Configure dynamic frequency scaling and automatic light sleep, falling back to
+// DFS only or manual clock switching depending on what the SDK was built with
+void setupPowerManagement() {
+  loopTaskHandle = xTaskGetCurrentTaskHandle();
+  loopCore = xPortGetCoreID();
+  
+  esp_pm_config_esp32s3_t pmConfig = {};
+  pmConfig.max_freq_mhz = CPU_FREQ_ACTIVE_MHZ;
+  pmConfig.min_freq_mhz = CPU_FREQ_IDLE_MHZ;
+  pmConfig.light_sleep_enable = true;
+  
+  esp_err_t err = esp_pm_configure(&pmConfig);
+  if (err == ESP_OK) {
+    powerMode = PM_LIGHT_SLEEP;
+  } else {
+    // Light sleep needs tickless idle in the SDK; try frequency scaling alone
+    pmConfig.light_sleep_enable = false;
+    err = esp_pm_configure(&pmConfig);
+    powerMode = err == ESP_OK ? PM_DFS : PM_MANUAL_DFS;
+  }
+  
+  if (powerMode != PM_MANUAL_DFS) {
+    esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "frame", &cpuFreqLock);
+    esp_pm_lock_acquire(cpuFreqLock);
+  }
+  if (powerMode == PM_LIGHT_SLEEP) {
+    esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pulse", &noSleepLock);
+    esp_pm_lock_acquire(noSleepLock);
+    esp_sleep_enable_gpio_wakeup();
+  }
+  
+  powerAccountStart = micros();
+  USBSerial.print("[Power] Idle mode: ");
+  USBSerial.println(POWER_MODE_NAMES[powerMode]);
+}
+
+void enterIdle() {
+  idleMode = true;
+  powerStats.idleEntries++;
+  if (powerMode == PM_MANUAL_DFS) {
+    setCpuFrequencyMhz(CPU_FREQ_IDLE_MHZ);
+  } else {
+    esp_pm_lock_release(cpuFreqLock);
+  }
+}
+
+void exitIdle() {
+  if (powerMode == PM_MANUAL_DFS) {
+    setCpuFrequencyMhz(CPU_FREQ_ACTIVE_MHZ);
+  } else {
+    esp_pm_lock_acquire(cpuFreqLock);
+  }
+  idleMode = false;
+}
+
+// Enter or leave idle mode based on whether the last frame did anything
+void updateIdleState(bool active) {
+  if (active) {
+    lastActivityTime = millis();
+    if (idleMode) exitIdle();
+  } else if (!idleMode && millis() - lastActivityTime > IDLE_ENTER_MS) {
+    enterIdle();
+  }
+}
+
+// Allow light sleep until `untilUs`; the throttle pin (low between pulses) wakes on high level
+void sleepUntil(uint32_t untilUs) {
+  uint32_t now = micros();
+  uint32_t ticks = (untilUs - now) / 1000 / portTICK_PERIOD_MS;  // Round down: never wake late
+  if (ticks == 0) return;
+  if (digitalRead(THROTTLE_PIN)) return;  // Mid-pulse: a level wake would fire immediately
+  
+  sleepWindowOpen = true;
+  gpio_wakeup_enable((gpio_num_t)THROTTLE_PIN, GPIO_INTR_HIGH_LEVEL);
+  esp_pm_lock_release(noSleepLock);
+  
+  vTaskDelay(ticks);
+  
+  esp_pm_lock_acquire(noSleepLock);
+  gpio_wakeup_disable((gpio_num_t)THROTTLE_PIN);
+  gpio_set_intr_type((gpio_num_t)THROTTLE_PIN, GPIO_INTR_ANYEDGE);
+  sleepWindowOpen = false;
+  
+  uint32_t resumed = micros();
+  uint32_t requested = now + ticks * portTICK_PERIOD_MS * 1000;
+  uint32_t latency = (int32_t)(resumed - requested) > 0 ? resumed - requested : 0;
+  powerStats.timerWakeCount++;
+  powerStats.timerWakeLatencySumUs += latency;
+  if (latency > powerStats.timerWakeLatencyMaxUs) powerStats.timerWakeLatencyMaxUs = latency;
+  powerStats.sleepWindowUs += resumed - now;
+}
+
+// Idle replacement for the frame delay: sleep through the gap before the next expected
+// pulse, then wait awake (low clock) for its falling edge or the next effect timer
+void idleWait() {
+  uint32_t now = micros();
+  uint32_t waitStart = now;
+  
+  // Never sleep past a scheduled burble (or any other effect timer)
+  uint32_t maxWaitUs = msUntilEffectTimer(IDLE_MAX_WAIT_MS) * 1000;
+  uint32_t deadline = now + maxWaitUs;
+  
+  if (powerMode == PM_LIGHT_SLEEP) {
+    // Only sleep when the receiver frame phase is known, so we wake before the rising edge
+    CaptureState capture = readCapture();
+    uint32_t period = capture.period;
+    bool signalPresent = now - capture.fallTime < 100000 && period > 5000 && period < 40000;
+    if (signalPresent) {
+      uint32_t nextRise = capture.riseTime + period - IDLE_WAKE_GUARD_US;
+      if ((int32_t)(deadline - nextRise) < 0) nextRise = deadline;
+      if ((int32_t)(nextRise - now) > IDLE_MIN_SLEEP_US) {
+        sleepUntil(nextRise);
+      }
+    } else {
+      sleepUntil(deadline);
+    }
+  }
+  
+  // Awake (no light sleep) until the falling edge notification or the deadline
+  long remainingUs = (int32_t)(deadline - micros());
+  if (remainingUs > 0) {
+    uint32_t ticks = max<uint32_t>(1, remainingUs / 1000 / portTICK_PERIOD_MS);
+    // A web command also notifies; only a pulse counts as an edge wake
+    if (ulTaskNotifyTake(pdTRUE, ticks) > 0 && !commandsPending()) {
+      CaptureState capture = readCapture();
+      uint32_t latency = micros() - capture.fallTime;
+      powerStats.edgeWakeCount++;
+      powerStats.edgeWakeLatencySumUs += latency;
+      if (latency > powerStats.edgeWakeLatencyMaxUs) powerStats.edgeWakeLatencyMaxUs = latency;
+      if (capture.flags & CAPTURE_SLEEP_DELAYED) powerStats.discardedPulses++;
+    }
+  }
+  
+  powerStats.idleUs += micros() - waitStart;
+}
+
+// Frame wait: returns as soon as the ISR reports a new pulse, otherwise when the frame
+// period is up (2 ms transients, 5 ms steady). A frame that changed nothing waits for
+// the next timed effect instead. Idle mode has its own sleep-aware wait.
+void waitForNextFrame() {
+  // Web commands already queued are applied without waiting
+  if (commandsPending()) {
+    ulTaskNotifyTake(pdTRUE, 0);
+    frameDueUs = micros();
+    return;
+  }
+  
+  if (idleMode) {
+    idleWait();
+    frameDueUs = micros();
+    return;
+  }
+  
+  uint32_t waitUs = (fastFrames ? FRAME_PERIOD_FAST_MS : FRAME_PERIOD_STEADY_MS) * 1000;
+  if (!frameActive) {
+    waitUs = max(waitUs, msUntilEffectTimer(IDLE_MAX_WAIT_MS) * 1000);
+  } else {
+    // Phase lock: a tick due shortly before the next receiver frame waits for that pulse
+    // instead, so the frame renders fresh input rather than repeating the old pulse
+    uint32_t nominal = nominalPulsePeriod;
+    if (nominal > 0) {
+      uint32_t nextEdge = readCapture().fallTime + nominal;
+      long edgeAfterTick = (long)(nextEdge - (lastFrameMicros + waitUs));
+      if (edgeAfterTick > 0 && edgeAfterTick < (long)waitUs / 2) {
+        waitUs += edgeAfterTick + PHASE_LOCK_GUARD_US;  // The pulse normally ends the wait first
+        phaseLockedFrames++;
+      }
+    }
+  }
+  
+  uint32_t elapsed = micros() - lastFrameMicros;
+  frameDueUs = lastFrameMicros + waitUs;
+  if (elapsed >= waitUs) {
+    ulTaskNotifyTake(pdTRUE, 0);  // The frame about to run reads any pulse already notified
+    deadlineFrames++;
+    return;
+  }
+  
+  // Round up to whole ticks so a frame never runs early on the timer path
+  uint32_t tickUs = portTICK_PERIOD_MS * 1000;
+  uint32_t ticks = (waitUs - elapsed + tickUs - 1) / tickUs;
+  if (ulTaskNotifyTake(pdTRUE, ticks) > 0) {
+    if (commandsPending()) {
+      frameDueUs = micros();  // Woken by a web command, not a pulse
+    } else {
+      pulseFrames++;
+      frameDueUs = readCapture().fallTime;
+    }
+  } else {
+    deadlineFrames++;
+  }
+}
+
+// Housekeeping timer, once a second: time fractions and estimated CPU current for the last second
+void samplePowerStats() {
+  uint32_t now = micros();
+  float total = now - powerAccountStart;
+  powerAccountStart = now;
+  if (total <= 0) return;
+  
+  // Everything that wasn't an idle wait ran at full clock (frame work + active delays)
+  float idle = min<float>(powerStats.idleUs, total);
+  float sleep = min<float>(powerStats.sleepWindowUs, idle);
+  powerStats.sleepFraction = sleep / total;
+  powerStats.idleFraction = (idle - sleep) / total;
+  powerStats.activeFraction = 1.0f - powerStats.sleepFraction - powerStats.idleFraction;
+  powerStats.estCurrentMa = powerStats.activeFraction * CURRENT_ACTIVE_MA +
+                            powerStats.idleFraction * CURRENT_DFS_MA +
+                            powerStats.sleepFraction * CURRENT_LIGHT_SLEEP_MA;
+  powerStats.idleUs = 0;
+  powerStats.sleepWindowUs = 0;
+  
+  RadioStateStats& radio = radioStats[radioOn ? 0 : 1];
+  radio.seconds++;
+  radio.currentSumMa += powerStats.estCurrentMa + (radioOn ? CURRENT_RADIO_MA : 0);
+  
+  frameRateHz = frameCounter * 1e6f / total;
+  frameCounter = 0;
+}
+
+///////////////////////
+// CPU LOAD
+///////////////////////
+
+#if configGENERATE_RUN_TIME_STATS
+#define CPU_LOAD_SOURCE "runTimeStats"
+
+void startCpuLoadMeter() {
+}
+
+// Busy share = 1 - each idle task's run time over the run-time clock (wall time)
+bool readCoreBusy(float busy[]) {
+  static TaskStatus_t status[MAX_TRACKED_TASKS];
+  static uint32_t lastIdle[portNUM_PROCESSORS];
+  static uint32_t lastTotal = 0;
+  uint32_t total;
+  UBaseType_t n = uxTaskGetSystemState(status, MAX_TRACKED_TASKS, &total);
+  if (n == 0) return false;
+  
+  uint32_t elapsed = total - lastTotal;
+  lastTotal = total;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    TaskHandle_t idle = xTaskGetIdleTaskHandleForCPU(core);
+    for (UBaseType_t i = 0; i < n; i++) {
+      if (status[i].xHandle != idle) continue;
+      uint32_t idleTime = status[i].ulRunTimeCounter - lastIdle[core];
+      lastIdle[core] = status[i].ulRunTimeCounter;
+      busy[core] = elapsed ? 1.0f - min<float>(1.0f, (float)idleTime / elapsed) : 0;
+    }
+  }
+  return elapsed > 0;
+}
+#else
+#define CPU_LOAD_SOURCE "tickSampling"
+TaskHandle_t idleTaskHandles[portNUM_PROCESSORS];
+volatile uint32_t busyTicks[portNUM_PROCESSORS];  // Ticks that interrupted a task other than idle
+
+// Runs in each core's tick interrupt
+void IRAM_ATTR cpuLoadTickHook() {
+  BaseType_t core = xPortGetCoreID();
+  if (xTaskGetCurrentTaskHandleForCPU(core) != idleTaskHandles[core]) busyTicks[core]++;
+}
+
+void startCpuLoadMeter() {
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    idleTaskHandles[core] = xTaskGetIdleTaskHandleForCPU(core);
+    esp_register_freertos_tick_hook_for_cpu(cpuLoadTickHook, core);
+  }
+}
+
+// Busy ticks over the ticks that should have elapsed (ticks skipped in light sleep count as idle).
+// Statistical: work that starts on a tick and ends before the next one is never sampled
+bool readCoreBusy(float busy[]) {
+  static uint32_t lastBusy[portNUM_PROCESSORS];
+  static uint32_t lastSampleUs = micros();
+  uint32_t now = micros();
+  float ticks = (now - lastSampleUs) * (configTICK_RATE_HZ / 1e6f);
+  lastSampleUs = now;
+  if (ticks < 1) return false;
+  
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    uint32_t count = busyTicks[core];
+    busy[core] = min<float>(1.0f, (count - lastBusy[core]) / ticks);
+    lastBusy[core] = count;
+  }
+  return true;
+}
+#endif
+
+// Housekeeping timer, once a second
+void sampleCpuLoad() {
+  float busy[portNUM_PROCESSORS] = {};
+  if (!readCoreBusy(busy)) return;
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    coreLoad[core].load = busy[core];
+    coreLoad[core].peakLoad = max(coreLoad[core].peakLoad, busy[core]);
+  }
+}
+
+///////////////////////
+// MEMORY HEALTH
+///////////////////////
+
+// 0 = all free heap is one block, approaching 1 = free heap split into small pieces
+float heapFragmentation(uint32_t freeHeap, uint32_t largestBlock) {
+  return freeHeap ? 1.0f - (float)largestBlock / freeHeap : 0;
+}
+
+void recordTaskStack(const char* name, TaskHandle_t handle, uint32_t stackFree) {
+  if (taskStackCount >= MAX_TRACKED_TASKS) return;
+  TaskStackInfo& info = taskStacks[taskStackCount++];
+  strncpy(info.name, name ? name : (handle ? pcTaskGetName(handle) : "?"), sizeof(info.name) - 1);
+  info.name[sizeof(info.name) - 1] = '\0';
+  info.stackFreeBytes = stackFree;
+}
+
+// Stack high-water marks for every task (ESP-IDF counts stack in bytes)
+void sampleTaskStacks() {
+  taskStackCount = 0;
+  taskCountTotal = uxTaskGetNumberOfTasks();
+  
+#if configUSE_TRACE_FACILITY
+  static TaskStatus_t status[MAX_TRACKED_TASKS];
+  UBaseType_t n = uxTaskGetSystemState(status, MAX_TRACKED_TASKS, nullptr);
+  for (UBaseType_t i = 0; i < n; i++) {
+    recordTaskStack(status[i].pcTaskName, status[i].xHandle, status[i].usStackHighWaterMark);
+  }
+  // uxTaskGetSystemState() returns nothing if the array is too small - fall through to named tasks
+  if (n > 0) return;
+#endif
+  
+  // Without the trace facility only tasks we hold handles for can be reported
+  recordTaskStack("loopTask", loopTaskHandle, uxTaskGetStackHighWaterMark(loopTaskHandle));
+  if (httpTaskHandle != nullptr) recordTaskStack("http", httpTaskHandle, uxTaskGetStackHighWaterMark(httpTaskHandle));
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    TaskHandle_t idle = xTaskGetIdleTaskHandleForCPU(core);
+    recordTaskStack(nullptr, idle, uxTaskGetStackHighWaterMark(idle));
+  }
+}
+
+// Housekeeping timer, at boot then every 10 s: heap figures into the history ring, fresh
+// stack high-water marks
+void sampleMemoryHealth() {
+  MemorySample& sample = memoryHistory[memorySampleCount % MEMORY_HISTORY_SIZE];
+  sample.timeMs = millis();
+  sample.freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  sample.largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  sample.minFreeHeap = heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT);
+  memorySampleCount++;
+  
+  sampleTaskStacks();
+}
+
+///////////////////////
+// UDP TELEMETRY STREAM
+///////////////////////
+
+// Optional capture stream: every published frame as a packed little-endian record, batched
+// into datagrams for a host on the local network (tools/udp_receiver.py writes CSV). The
+// loop only copies the record into a ring; the server task sends, so no frame ever waits
+// on the network.
+#define UDP_STREAM_DEFAULT_PORT 4210
+#define UDP_RING_SIZE 128                // Records, must be a power of two (over 250 ms at 500 Hz)
+#define UDP_RECORDS_PER_DATAGRAM 40      // 16 + 40 * 30 bytes: one unfragmented datagram
+#define UDP_FLUSH_MS 20                  // Longest a record waits for its datagram
+#define UDP_STREAM_MAGIC 0x4C544641      // "AFTL"
+#define UDP_STREAM_VERSION 1
+
+struct __attribute__((packed)) UdpHeader {
+  uint32_t magic;
+  uint16_t version;
+  uint16_t count;                        // Records in this datagram
+  uint32_t sequence;                     // Datagram number since the stream started (gaps = lost datagrams)
+  uint32_t dropped;                      // Records lost to a full ring since the stream started
+};
+
+struct __attribute__((packed)) UdpRecord {
+  uint32_t frame;                        // Telemetry frame number
+  uint32_t frameStartUs;
+  uint16_t pulse;                        // us
+  int8_t throttle;                       // -100 .. 100
+  uint8_t captureFlags;                  // CaptureFlags: input validity
+  uint8_t frameMode;                     // 0 steady, 1 fast, 2 idle
+  uint8_t calibrationStep;
+  uint8_t activeEffects;                 // Bit per EffectId
+  uint8_t detailTier;
+  uint8_t r, g, b;                       // First LED as shown
+  uint8_t burstCount;
+  uint16_t latencyUs;                    // Edge to output
+  uint32_t frameDtUs;
+  uint32_t workUs;
+};
+
+UdpRecord udpRing[UDP_RING_SIZE];
+std::atomic<uint32_t> udpHead(0);        // Advanced by the loop
+std::atomic<uint32_t> udpTail(0);        // Advanced by the server task
+std::atomic<bool> udpStreaming(false);
+uint32_t udpDropped = 0;                 // Records lost to a full ring, since boot (loop only)
+
+// Server task side
+int udpSocket = -1;                      // Opened by the first stream and kept: starting and stopping allocate nothing
+struct sockaddr_in udpTarget;
+IPAddress udpHost;
+uint16_t udpPort = UDP_STREAM_DEFAULT_PORT;
+uint32_t udpDroppedAtStart = 0;
+uint32_t udpDatagrams = 0;
+uint32_t udpRecordsSent = 0;
+uint32_t udpSendErrors = 0;
+uint32_t udpLastFlushMs = 0;
+uint8_t udpDatagram[sizeof(UdpHeader) + UDP_RECORDS_PER_DATAGRAM * sizeof(UdpRecord)];
+
+// Loop, from publishTelemetry(): one record per frame while streaming
+void pushUdpRecord(const Telemetry& t) {
+  if (!udpStreaming.load(std::memory_order_relaxed)) return;
+  uint32_t head = udpHead.load(std::memory_order_relaxed);
+  if (head - udpTail.load(std::memory_order_acquire) >= UDP_RING_SIZE) {
+    udpDropped++;
+    return;
+  }
+  
+  UdpRecord& r = udpRing[head & (UDP_RING_SIZE - 1)];
+  r.frame = t.frame;
+  r.frameStartUs = t.frameStartUs;
+  r.pulse = t.pulse;
+  r.throttle = t.throttle;
+  r.captureFlags = t.captureFlags;
+  r.frameMode = t.idle ? 2 : (t.fastFrames ? 1 : 0);
+  r.calibrationStep = t.calibrationStep;
+  r.activeEffects = t.activeEffects;
+  r.detailTier = t.detailTier;
+  r.r = t.led.r;
+  r.g = t.led.g;
+  r.b = t.led.b;
+  r.burstCount = t.burstCount;
+  r.latencyUs = t.latencyUs;
+  r.frameDtUs = t.frameDtUs;
+  r.workUs = t.workUs;
+  udpHead.store(head + 1, std::memory_order_release);
+}
+
+// Server task (from /api/udp). False if no socket could be opened.
+bool startUdpStream(IPAddress host, uint16_t port) {
+  if (udpSocket < 0) udpSocket = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (udpSocket < 0) return false;
+  udpHost = host;
+  udpPort = port;
+  memset(&udpTarget, 0, sizeof(udpTarget));
+  udpTarget.sin_family = AF_INET;
+  udpTarget.sin_port = htons(port);
+  udpTarget.sin_addr.s_addr = (uint32_t)host;  // IPAddress holds it in network order
+  udpDroppedAtStart = udpDropped;
+  udpDatagrams = udpRecordsSent = udpSendErrors = 0;
+  udpTail.store(udpHead.load(std::memory_order_acquire), std::memory_order_release);  // Only frames from now on
+  udpLastFlushMs = millis();
+  udpStreaming = true;
+  USBSerial.printf("[UDP] Streaming frames to %u.%u.%u.%u:%u\n", host[0], host[1], host[2], host[3], port);
+  return true;
+}
+
+void stopUdpStream() {
+  if (!udpStreaming) return;
+  udpStreaming = false;                  // The socket stays open for the next stream
+  USBSerial.printf("[UDP] Stream stopped after %lu records\n", (unsigned long)udpRecordsSent);
+}
+
+// Server task, after every poll: queued records out in full datagrams, or whatever is
+// queued once the oldest has waited UDP_FLUSH_MS
+void serviceUdpStream() {
+  if (!udpStreaming) return;
+  uint32_t now = millis();
+  uint32_t tail = udpTail.load(std::memory_order_relaxed);
+  uint32_t pending = udpHead.load(std::memory_order_acquire) - tail;
+  if (pending < UDP_RECORDS_PER_DATAGRAM && now - udpLastFlushMs < UDP_FLUSH_MS) return;
+  udpLastFlushMs = now;
+  
+  while (pending > 0) {
+    uint16_t count = min<uint32_t>(pending, UDP_RECORDS_PER_DATAGRAM);
+    UdpHeader header = { UDP_STREAM_MAGIC, UDP_STREAM_VERSION, count, udpDatagrams, udpDropped - udpDroppedAtStart };
+    memcpy(udpDatagram, &header, sizeof(header));
+    for (uint16_t i = 0; i < count; i++) {
+      memcpy(udpDatagram + sizeof(header) + i * sizeof(UdpRecord), &udpRing[(tail + i) & (UDP_RING_SIZE - 1)], sizeof(UdpRecord));
+    }
+    tail += count;
+    pending -= count;
+    udpTail.store(tail, std::memory_order_release);
+    
+    size_t length = sizeof(header) + count * sizeof(UdpRecord);
+    udpDatagrams++;
+    // Straight from the static datagram buffer: no per-packet copy or allocation in WiFiUDP
+    if (sendto(udpSocket, udpDatagram, length, MSG_DONTWAIT, (struct sockaddr*)&udpTarget, sizeof(udpTarget)) == (int)length) {
+      udpRecordsSent += count;
+    } else {
+      udpSendErrors++;                   // Counted as a sequence gap by the receiver
+    }
+  }
+  lastWebRequestTime = now;              // A capture in progress keeps the radio on
+}
+
+///////////////////////
+// HTTP SERVER TASK
+///////////////////////
+
+// The web server runs on core 0 next to the WiFi stack, so no request - however slow the
+// client - ever delays a frame on core 1. Handlers talk to the pipeline only through the
+// command queue and config snapshots; everything else they read is telemetry.
+#define HTTP_TASK_STACK 6144             // Bytes; handlers format into the static responseBuffer
+#define HTTP_TASK_PRIORITY 1             // Same as loopTask, which has a core of its own
+#define HTTP_TASK_CORE 0
+#define HTTP_POLL_MS 250                 // Socket events end the wait at once; this paces timeouts and the scan
+
+// Live telemetry (/api/events): Server-Sent Events at a set rate while a stream is open
+#define EVENT_RATE_DEFAULT_HZ 10
+#define EVENT_RATE_MAX_HZ 50
+uint8_t eventRateHz = EVENT_RATE_DEFAULT_HZ;   // Set by /api/events/rate (not persisted)
+uint32_t nextEventMs = 0;
+
+void httpTask(void*) {
+  for (;;) {
+    // With a stream open, wake in time for its next event
+    uint32_t waitMs = HTTP_POLL_MS;
+    if (server.eventStreams() > 0) {
+      long untilEvent = (long)(nextEventMs - millis());
+      waitMs = untilEvent <= 0 ? 0 : min<uint32_t>(untilEvent, waitMs);
+    }
+    if (udpStreaming) waitMs = min<uint32_t>(waitMs, UDP_FLUSH_MS);
+    server.poll(waitMs);
+    wdtHandler[0] = '\0';                 // Every handler has returned
+    esp_task_wdt_reset();
+    configQuiescent(CONFIG_READER_WEB);  // No handler is running, so no config snapshot is held
+    serviceEventStreams();
+    serviceUdpStream();
+    if (radioTeardownPending) radioTeardown();
+    
+    // Background WiFi scan results (AP setup mode)
+    serviceNetworkScan();
+    if (apRestartAt != 0 && (long)(millis() - apRestartAt) >= 0) {
+      ESP.restart();
+    }
+  }
+}
+
+void startHttpTask() {
+  server.onWait(feedHttpWatchdog);       // A chunked body can wait on a client for longer than the watchdog
+  xTaskCreatePinnedToCore(httpTask, "http", HTTP_TASK_STACK, nullptr, HTTP_TASK_PRIORITY, &httpTaskHandle, HTTP_TASK_CORE);
+}
+
+///////////////////////
+// SETUP
+///////////////////////
+
+// Wheel clocks start now. Periodic housekeeping is armed here; effects arm their own timers.
+void startTimers() {
+  uint32_t now = millis();
+  timerInit(effectTimers, effectTimerSlots, EFFECT_TIMER_COUNT, now);
+  timerInit(housekeepingTimers, housekeepingTimerSlots, HOUSEKEEPING_TIMER_COUNT, now);
+  
+  effectTimerSlots[TIMER_BURST].callback = burstStep;
+  effectTimerSlots[TIMER_BURBLE].callback = burbleFired;
+  effectTimerSlots[TIMER_FLICKER_NOISE].callback = flickerNoiseStep;
+  effectTimerSlots[TIMER_GESTURE_FEEDBACK].callback = endGestureFeedback;
+  effectTimerSlots[TIMER_CAL_FLASH].callback = endCalibrationFlash;
+  
+  housekeepingTimerSlots[TIMER_DEBUG_LINE].callback = printTelemetry;
+  housekeepingTimerSlots[TIMER_POWER_SAMPLE].callback = samplePowerStats;
+  housekeepingTimerSlots[TIMER_CPU_SAMPLE].callback = sampleCpuLoad;
+  housekeepingTimerSlots[TIMER_MEMORY_SAMPLE].callback = sampleMemoryHealth;
+  housekeepingTimerSlots[TIMER_RADIO_OFF].callback = radioOffRequested;
+  
+  timerStartPeriodic(housekeepingTimers, TIMER_DEBUG_LINE, now, DEBUG_INTERVAL_MS, DEBUG_INTERVAL_MS);
+  timerStartPeriodic(housekeepingTimers, TIMER_POWER_SAMPLE, now, POWER_SAMPLE_INTERVAL_MS, POWER_SAMPLE_INTERVAL_MS);
+  timerStartPeriodic(housekeepingTimers, TIMER_CPU_SAMPLE, now, CPU_LOAD_INTERVAL_MS, CPU_LOAD_INTERVAL_MS);
+  timerStartPeriodic(housekeepingTimers, TIMER_MEMORY_SAMPLE, now, MEMORY_SAMPLE_INTERVAL_MS, 0);
+}
+
+void setup() {
+  // Initialize Serial for debugging
+  USBSerial.begin(115200);
+  delay(1000); // Wait for serial connection
+  
+  USBSerial.println("\n\n==================================");
+  USBSerial.println("ESP32-S3 Afterfire Effect v1.0");
+  USBSerial.println("WaveShare ESP32-S3-Zero");
+  USBSerial.println("==================================");
+  USBSerial.print("Chip Model: ");
+  USBSerial.println(ESP.getChipModel());
+  USBSerial.print("Chip Revision: ");
+  USBSerial.println(ESP.getChipRevision());
+  USBSerial.print("CPU Frequency: ");
+  USBSerial.print(ESP.getCpuFreqMHz());
+  USBSerial.println(" MHz");
+  USBSerial.println("==================================");
+  checkWatchdogReset();
+  
+  // Initialize EEPROM
+  EEPROM.begin(EEPROM_SIZE);
+  loadSettings();
+  loadWiFiCache();
+  loadRadioSettings();
+  
+  // Initialize throttle input
+  // Own IRAM-flagged ISR service rather than attachInterrupt(), whose handler is
+  // masked while flash is busy (edges during an EEPROM commit would be lost)
+  pinMode(THROTTLE_PIN, INPUT);
+  gpio_set_intr_type((gpio_num_t)THROTTLE_PIN, GPIO_INTR_ANYEDGE);
+  esp_err_t isrErr = gpio_install_isr_service(ESP_INTR_FLAG_IRAM);
+  if (isrErr != ESP_OK && isrErr != ESP_ERR_INVALID_STATE) {
+    USBSerial.print("[Input] GPIO ISR service failed: ");
+    USBSerial.println(esp_err_to_name(isrErr));
+  }
+  gpio_isr_handler_add((gpio_num_t)THROTTLE_PIN, readThrottle, nullptr);
+  USBSerial.println("Throttle interrupt attached to pin 2");
+  
+  startTimers();
+  setupPowerManagement();
+  startCpuLoadMeter();
+  scheduleNextBurble();
+
+  // Initialize FastLED
+  FastLED.addLeds<LED_TYPE, LED_PIN, COLOR_ORDER>(leds, NUM_LEDS);
+  FastLED.setBrightness(MAX_BRIGHTNESS);
+  FastLED.clear();
+  FastLED.show();
   USBSerial.print("FastLED initialized: ");
   USBSerial.print(NUM_LEDS);
   USBSerial.println(" LED(s) on pin 3");
@@ -657,6 +2394,8 @@ void setup() {
     setupAPWebServer();
     server.begin();
     USBSerial.println("[AP] Web server started on port 80");
+    startHttpTask();
+    startFrameWatchdog();
     return;
   }
   
@@ -665,18 +2404,20 @@ void setup() {
   USBSerial.print("[WiFi] SSID: ");
   USBSerial.println(settings.ssid);
   
+  WiFi.persistent(false);        // Credentials live in our EEPROM; don't rewrite NVS on every begin()
+  WiFi.setAutoReconnect(false);  // Reconnection is handled by serviceWiFi() with backoff
   WiFi.mode(WIFI_STA);
-  WiFi.begin(settings.ssid, settings.password);
+  beginWiFiConnect(true);
   
-  int wifiAttempts = 0;
-  while (WiFi.status() != WL_CONNECTED && wifiAttempts < 20) {
-    delay(500);
-    USBSerial.print(".");
-    wifiAttempts++;
+  // Drive the state machine until the first attempt resolves (fast connect usually
+  // finishes in a few hundred ms; a full connect is bounded by WIFI_CONNECT_TIMEOUT)
+  while (wifiState == WIFI_STATE_CONNECTING) {
+    serviceWiFi();
+    delay(10);
   }
   
-  if (WiFi.status() == WL_CONNECTED) {
-    USBSerial.println("\n[WiFi] Connected!");
+  if (wifiState == WIFI_STATE_CONNECTED) {
+    USBSerial.println("[WiFi] Connected!");
     USBSerial.print("[WiFi] IP Address: ");
     USBSerial.println(WiFi.localIP());
     USBSerial.print("[WiFi] Signal Strength: ");
@@ -688,13 +2429,10 @@ void setup() {
     ArduinoOTA.setPassword("afterfire2026");
     
     ArduinoOTA.onStart([]() {
-      String type;
-      if (ArduinoOTA.getCommand() == U_FLASH) {
-        type = "sketch";
-      } else {
-        type = "filesystem";
-      }
-      USBSerial.println("[OTA] Start updating " + type);
+      USBSerial.print("[OTA] Start updating ");
+      USBSerial.println(ArduinoOTA.getCommand() == U_FLASH ? "sketch" : "filesystem");
+      // The update runs inside ArduinoOTA.handle() for its whole duration
+      esp_task_wdt_delete(NULL);
       fill_solid(leds, NUM_LEDS, CRGB::Red);
       FastLED.show();
     });
@@ -710,6 +2448,7 @@ void setup() {
     });
     
     ArduinoOTA.onError([](ota_error_t error) {
+      esp_task_wdt_add(NULL);
       USBSerial.printf("[OTA] Error[%u]: ", error);
       if (error == OTA_AUTH_ERROR) USBSerial.println("Auth Failed");
       else if (error == OTA_BEGIN_ERROR) USBSerial.println("Begin Failed");
@@ -728,13 +2467,25 @@ void setup() {
     server.begin();
     USBSerial.println("[Web] Server started on port 80");
   } else {
-    USBSerial.println("\n[WiFi] Connection failed - starting AP mode for reconfiguration");
+    USBSerial.println("[WiFi] Connection failed - starting AP mode for reconfiguration");
+    wifiState = WIFI_STATE_IDLE;
     startAPMode();
     setupAPWebServer();
     server.begin();
     USBSerial.println("[AP] Web server started on port 80");
   }
   
+#ifdef AFTERFIRE_DIAGNOSTICS
+  runJsonWriterCheck();
+#endif
+  
+  // Requests are served from here on (the check above borrows responseBuffer)
+  startHttpTask();
+#ifdef AFTERFIRE_DIAGNOSTICS
+  runHeapSoakCheck();                  // A client of the server task, before the frame watchdog starts
+#endif
+  startFrameWatchdog();
+  frameDueUs = micros();
   USBSerial.println("\nSystem ready!\n");
 }
 
@@ -743,116 +2494,357 @@ void setup() {
 ///////////////////////
 
 void loop() {
+  uint32_t loopStart = ESP.getCycleCount();
+
+  // Drop last iteration's config snapshot and pick up the newest one
+  configQuiescent(CONFIG_READER_PIPELINE);
+  config = configAcquire();
+
+  // Render first: the wait just ended on a fresh pulse or a due tick, so nothing runs
+  // between the input arriving and the LEDs showing it
+  chooseDetailTier();
+  {
+    StageTimer timer(STAGE_FRAME);
+    renderFrame();
+  }
+  learnFrameCosts();
 
-  // Handle web server requests (both AP and normal mode)
-  server.handleClient();
+  {
+    StageTimer timer(STAGE_HOUSEKEEPING);
+    
+    // Keep the station connected in the background (reconnects with backoff)
+    if (!inAPMode) {
+      serviceRadio();
+      if (radioOn) serviceWiFi();
+    }
+    
+    // Persist config changes once they have settled
+    uint32_t generation = configGeneration.load();
+    if (generation != configSavedGeneration) {
+      configSavedGeneration = generation;
+      markSettingsDirty();
+    }
+    if (settingsSaveDue()) {
+      settingsDirty = false;
+      saveSettings();
+    }
+    if (wifiSavePending) {
+      wifiSavePending = false;
+      saveSettings();
+      USBSerial.println("[AP] Settings saved, rebooting...");
+      uint32_t restartAt = millis() + AP_RESTART_DELAY_MS;
+      apRestartAt = restartAt != 0 ? restartAt : 1;
+    }
+    
+    // Samplers, the debug line and a commanded radio-off
+    timerAdvance(housekeepingTimers, millis());
+#ifdef AFTERFIRE_DIAGNOSTICS
+    serviceCommitStress();
+#endif
+  }
   
-  // Handle OTA updates (only in normal WiFi mode)
-  if (!inAPMode && WiFi.status() == WL_CONNECTED) {
+  // Handle OTA updates (only in normal WiFi mode with the radio on)
+  if (!inAPMode && radioOn && WiFi.status() == WL_CONNECTED) {
+    StageTimer timer(STAGE_OTA);
     ArduinoOTA.handle();
   }
+  
+  uint32_t loopCycles = normaliseCycles(ESP.getCycleCount() - loopStart);
+  publishTelemetry(loopCycles / PROFILE_REF_MHZ);
+  checkFrameDeadline(loopCycles);
+  esp_task_wdt_reset();
+  
+  updateIdleState(frameActive);
+  waitForNextFrame();
+}
+
+///////////////////////
+// FRAME PIPELINE
+///////////////////////
+
+// Scale a per-5 ms fade amount to the actual frame interval so fades keep the same
+// speed at every frame rate
+uint8_t scaledFade(uint8_t amountPer5ms) {
+  return min<uint32_t>(255, (uint32_t)amountPer5ms * frameDtUs / 5000);
+}
+
+// Output at the frame's detail tier: dithered every frame at full detail, otherwise only
+// frames that changed the LEDs (at most every 5 ms at minimal detail)
+void showFrame() {
+  static CRGB lastOutput[NUM_LEDS];
+  static uint32_t lastShowMs = 0;
+  if (frameTier != TIER_FULL) {
+    if (memcmp(lastOutput, leds, sizeof(leds)) == 0) return;
+    if (frameTier == TIER_MINIMAL && millis() - lastShowMs < FRAME_PERIOD_STEADY_MS) return;
+  }
+  
+  StageTimer timer(STAGE_SHOW);
+  FastLED.setDither(frameTier == TIER_FULL ? BINARY_DITHER : DISABLE_DITHER);
+  FastLED.show();
+  memcpy(lastOutput, leds, sizeof(leds));
+  lastShowMs = millis();
+}
+
+// A new pulse's falling edge to the end of the frame that rendered it (LEDs latched)
+void recordEdgeToOutput(uint32_t fallTime) {
+  uint32_t latency = micros() - fallTime;
+  edgeToOutput.count++;
+  edgeToOutput.sumUs += latency;
+  edgeToOutput.lastUs = latency;
+  if (latency > edgeToOutput.maxUs) edgeToOutput.maxUs = latency;
+}
+
+// Map a pulse width to throttle: -100 (full brake) .. 0 (neutral) .. 100 (full throttle)
+int pulseToThrottle(uint16_t pulse, const RenderConfig& cfg) {
+  int throttle;
+  if (pulse >= cfg.neutralMin && pulse <= cfg.neutralMax) {
+    throttle = 0;  // In neutral dead zone
+  } else if (pulse > cfg.neutralMax) {
+    // Forward throttle: neutral to max
+    throttle = map(pulse, cfg.neutralMax, cfg.maxPulse, 0, 100);
+  } else {
+    // Reverse/brake: min to neutral
+    throttle = map(pulse, cfg.minPulse, cfg.neutralMin, -100, 0);
+  }
+  return constrain(throttle, -100, 100);
+}
+
+// Effect timer: the completion flash is over
+void endCalibrationFlash() {
+  if (calibrationStep == CAL_COMPLETE) calibrationStep = CAL_IDLE;
+}
 
-  uint16_t current = pulseWidth;
+void renderFrame() {
+  uint16_t current;
+  bool newPulse;
+  uint32_t pulseFallTime;
+  uint32_t commandsApplied;
+  frameActive = true;
+  
+  uint32_t frameStart = micros();
+  frameDtUs = frameStart - lastFrameMicros;
+  lastFrameMicros = frameStart;
+  frameCounter++;
+  if (frameDtUs > FRAME_STALL_US) {
+    frameStalls++;
+    if (frameDtUs > maxFrameStallUs) maxFrameStallUs = frameDtUs;
+  }
+  {
+    StageTimer timer(STAGE_INPUT);
+    
+    // Apply queued web commands - the only point where the frame pipeline's state changes
+    commandsApplied = applyCommands();
+    
+    CaptureState capture = readCapture();
+    current = capture.width;
+    sampleRadioJitter(capture, frameStart);
+    
+    static uint32_t lastPulseFrame = 0;
+    // Only clean pulses: a discarded one (sleep-delayed or out of range) carries the kept
+    // width and a timestamp that can't be trusted, so it feeds neither the gesture
+    // recogniser nor the edge-to-output latency
+    newPulse = capture.frame != lastPulseFrame && !(capture.flags & (CAPTURE_SLEEP_DELAYED | CAPTURE_OUT_OF_RANGE));
+    lastPulseFrame = capture.frame;
+    pulseFallTime = capture.fallTime;
+    
+    Telemetry& t = telemetryBack();
+    t.pulse = current;
+    t.captureFlags = capture.flags;
+    t.throttle = 0;
+    t.prevThrottle = 0;
+    t.activeEffects = 0;
+  }
+  
+  // Burst flashes, burble and flicker timing, feedback and calibration flash expiry
+  {
+    StageTimer timer(STAGE_EFFECT_TIMERS);
+    timerAdvance(effectTimers, millis());
+  }
 
   // Handle calibration mode - manual step confirmation
   if (calibrationStep != CAL_IDLE && calibrationStep != CAL_COMPLETE) {
     // Just keep LEDs on during calibration to show it's active
     fill_solid(leds, NUM_LEDS, CRGB::Blue);
+    StageTimer timer(STAGE_SHOW);
     FastLED.show();
-    delay(5);
     return; // Don't run normal effects during calibration
   }
   
   if (calibrationStep == CAL_COMPLETE) {
-    // Show green to indicate completion
+    // Show green to indicate completion, for a second (the effect timer ends it)
+    if (!timerPending(effectTimers, TIMER_CAL_FLASH)) scheduleEffectTimer(TIMER_CAL_FLASH, CAL_FLASH_MS);
     fill_solid(leds, NUM_LEDS, CRGB::Green);
+    StageTimer timer(STAGE_SHOW);
     FastLED.show();
-    delay(1000);
-    calibrationStep = CAL_IDLE;
     return;
   }
 
   // Map throttle: brake to neutral to throttle
   int throttle;
-  if (current >= NEUTRAL_MIN && current <= NEUTRAL_MAX) {
-    throttle = 0;  // In neutral dead zone
-  } else if (current > NEUTRAL_MAX) {
-    // Forward throttle: neutral to max
-    throttle = map(current, NEUTRAL_MAX, MAX_PULSE, 0, 100);
-  } else {
-    // Reverse/brake: min to neutral
-    throttle = map(current, MIN_PULSE, NEUTRAL_MIN, -100, 0);
-  }
-  throttle = constrain(throttle, -100, 100);
-  
   int prevThrottle;
-  if (prevPulse >= NEUTRAL_MIN && prevPulse <= NEUTRAL_MAX) {
-    prevThrottle = 0;
-  } else if (prevPulse > NEUTRAL_MAX) {
-    prevThrottle = map(prevPulse, NEUTRAL_MAX, MAX_PULSE, 0, 100);
-  } else {
-    prevThrottle = map(prevPulse, MIN_PULSE, NEUTRAL_MIN, -100, 0);
-  }
-  prevThrottle = constrain(prevThrottle, -100, 100);
-
-  // Debug output every 500ms
-  static unsigned long lastDebug = 0;
-  if (millis() - lastDebug > 500) {
-    USBSerial.print("PWM: ");
-    USBSerial.print(current);
-    USBSerial.print(" | Neutral Range: ");
-    USBSerial.print(NEUTRAL_MIN);
-    USBSerial.print("-");
-    USBSerial.print(NEUTRAL_MAX);
-    USBSerial.print(" | Throttle: ");
-    USBSerial.print(throttle);
-    USBSerial.print("% | Prev: ");
-    USBSerial.print(prevThrottle);
-    USBSerial.print("% | Burst: ");
-    USBSerial.print(burstActive ? "YES" : "NO");
-    USBSerial.print(" | BF:");
-    USBSerial.print(enableBackfire ? "ON" : "OFF");
-    USBSerial.print(" | BC:");
-    USBSerial.print(enableBrakeCrackle ? "ON" : "OFF");
-    USBSerial.print(" | IB:");
-    USBSerial.println(enableIdleBurble ? "ON" : "OFF");
-    lastDebug = millis();
-  }
-
-  handleRPMFlicker(throttle);
-  detectBackfire(prevThrottle, throttle);
-  detectBrakeCrackle(prevThrottle, throttle);
-  idleBurble(throttle);
-  handleBurst();
+  {
+    StageTimer timer(STAGE_MAPPING);
+    throttle = pulseToThrottle(current, *config);
+    prevThrottle = pulseToThrottle(prevPulse, *config);
+    
+    if (abs((int)current - (int)prevPulse) > PULSE_JITTER_US) {
+      lastInputChangeTime = millis();
+    }
+    
+    // One gesture sample per receiver pulse
+    if (newPulse) {
+      applyGesture(updateGesture(stickGestures, throttle, millis()));
+    }
+    
+    Telemetry& t = telemetryBack();
+    t.throttle = throttle;
+    t.prevThrottle = prevThrottle;
+  }
+
+  {
+    StageTimer timer(STAGE_RPM_FLICKER);
+    handleRPMFlicker(throttle);
+  }
+  {
+    StageTimer timer(STAGE_BACKFIRE);
+    detectBackfire(prevThrottle, throttle);
+  }
+  {
+    StageTimer timer(STAGE_BRAKE_CRACKLE);
+    detectBrakeCrackle(prevThrottle, throttle);
+  }
+  {
+    StageTimer timer(STAGE_IDLE_BURBLE);
+    idleBurble(throttle);
+  }
   
   // Turn off LEDs if no active effects and no burst
-  if (!burstActive && !enableRPMFlicker && !enableIdleBurble) {
-    fadeToBlackBy(leds, NUM_LEDS, 50);
+  if (!burstActive && !config->enableRPMFlicker && !config->enableIdleBurble) {
+    fadeToBlackBy(leds, NUM_LEDS, scaledFade(50));
   }
 
   prevPulse = current;
 
-  FastLED.show();
-  delay(5);
+  drawGestureFeedback();
+  drawAPIndicator();
+  showFrame();
+  if (newPulse) recordEdgeToOutput(pulseFallTime);
+  
+  // Idle candidate: neutral, nothing queued, no burst and the LEDs didn't change
+  bool ledsChanged = memcmp(lastShownLeds, leds, sizeof(leds)) != 0;
+  memcpy(lastShownLeds, leds, sizeof(leds));
+  frameActive = throttle != 0 || prevThrottle != 0 || burstActive || commandsApplied > 0 || ledsChanged;
+  
+  // Render fast while the stick is moving or a burst animates, so a release is sampled
+  // within 2 ms of the pulse that carries it
+  fastFrames = burstActive || millis() - lastInputChangeTime < TRANSIENT_HOLD_MS;
+}
+
+///////////////////////
+// TELEMETRY
+///////////////////////
+
+// Buffer the current frame writes into (the one readers aren't being pointed at)
+Telemetry& telemetryBack() {
+  return telemetryBuffers[(telemetrySeq.load(std::memory_order_relaxed) + 1) & 1];
+}
+
+// End of loop: complete the back buffer and make it the latest
+void publishTelemetry(uint32_t workUs) {
+  uint32_t seq = telemetrySeq.load(std::memory_order_relaxed);
+  Telemetry& t = telemetryBuffers[(seq + 1) & 1];
+  t.frame = seq + 1;
+  t.timeMs = millis();
+  t.calibrationStep = calibrationStep;
+  t.burstCount = burstCount;
+  t.burstActive = burstActive;
+  t.idle = idleMode;
+  t.fastFrames = fastFrames;
+  t.detailTier = frameTier;
+  t.latencyUs = min<uint32_t>(edgeToOutput.lastUs, UINT16_MAX);
+  t.led = leds[0];
+  t.frameStartUs = lastFrameMicros;
+  t.frameDtUs = frameDtUs;
+  t.workUs = workUs;
+  if (burstActive) t.activeEffects |= 1 << burstEffect;
+  telemetrySeq.store(seq + 1, std::memory_order_release);
+  pushUdpRecord(t);
+  
+  // Next frame's writes go to the buffer readers may still be copying: order them after the flip
+  std::atomic_thread_fence(std::memory_order_release);
+}
+
+// Latest published frame; retries only if a flip happened mid-copy
+Telemetry readTelemetry() {
+  Telemetry snapshot;
+  uint32_t before, after;
+  do {
+    before = telemetrySeq.load(std::memory_order_acquire);
+    snapshot = telemetryBuffers[before & 1];
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = telemetrySeq.load(std::memory_order_relaxed);
+  } while (before != after);
+  return snapshot;
+}
+
+// Housekeeping timer: debug output every 500ms
+void printTelemetry() {
+  StageTimer timer(STAGE_DEBUG);
+  
+  Telemetry t = readTelemetry();
+  USBSerial.print("PWM: ");
+  USBSerial.print(t.pulse);
+  USBSerial.print(" | Neutral Range: ");
+  USBSerial.print(config->neutralMin);
+  USBSerial.print("-");
+  USBSerial.print(config->neutralMax);
+  USBSerial.print(" | Throttle: ");
+  USBSerial.print(t.throttle);
+  USBSerial.print("% | Prev: ");
+  USBSerial.print(t.prevThrottle);
+  USBSerial.print("% | Burst: ");
+  USBSerial.print(t.burstActive ? "YES" : "NO");
+  USBSerial.print(" | BF:");
+  USBSerial.print(config->enableBackfire ? "ON" : "OFF");
+  USBSerial.print(" | BC:");
+  USBSerial.print(config->enableBrakeCrackle ? "ON" : "OFF");
+  USBSerial.print(" | IB:");
+  USBSerial.print(config->enableIdleBurble ? "ON" : "OFF");
+  USBSerial.printf(" | CPU: %d%%/%d%% @ %.0f Hz\n", (int)(coreLoad[0].load * 100),
+                   (int)(coreLoad[portNUM_PROCESSORS - 1].load * 100), frameRateHz);
 }
 
 ///////////////////////
 // RPM FLICKER
 ///////////////////////
 
+int flickerNoise = 0;
+
+// Effect timer: next flicker noise value (re-armed by the flicker while it is drawing)
+void flickerNoiseStep() {
+  flickerNoise = random(-30, 30);
+}
+
 void handleRPMFlicker(int throttle) {
-  if (!enableRPMFlicker) return;
+  if (!config->enableRPMFlicker) return;
   if (burstActive) return;
 
-  if (throttle > rpmFlickerThreshold) {
+  if (throttle > config->rpmFlickerThreshold) {
 
     // Map throttle to color progression: red -> orange -> yellow -> white -> blue
-    int intensity = map(throttle, rpmFlickerThreshold, 100, 0, 255);
+    int intensity = map(throttle, config->rpmFlickerThreshold, 100, 0, 255);
     intensity = constrain(intensity, 0, 255);
     
     CRGB color;
-    int flicker = random(-30, 30);
-    int brightness = constrain(intensity + flicker, 0, 255);
+    
+    // New flicker noise every 5 ms regardless of frame rate (slower or none at lower detail)
+    if (frameTier == TIER_MINIMAL) {
+      flickerNoise = 0;
+      timerCancel(effectTimers, TIMER_FLICKER_NOISE);
+    } else if (!timerPending(effectTimers, TIMER_FLICKER_NOISE)) {
+      scheduleEffectTimer(TIMER_FLICKER_NOISE, frameTier == TIER_FULL ? FRAME_PERIOD_STEADY_MS : FLICKER_REDUCED_PERIOD_MS);
+    }
+    int brightness = constrain(intensity + flickerNoise, 0, 255);
     
     if (brightness < 60) {
       // Deep red (low throttle)
@@ -875,879 +2867,1072 @@ void handleRPMFlicker(int throttle) {
     }
     
     fill_solid(leds, NUM_LEDS, color);
+    telemetryBack().activeEffects |= 1 << EFFECT_RPM_FLICKER;
 
   } else {
-    fadeToBlackBy(leds, NUM_LEDS, 40);
+    fadeToBlackBy(leds, NUM_LEDS, scaledFade(40));
   }
 }
 
 ///////////////////////
-// BACKFIRE DETECTION
+// BACKFIRE DETECTION
+///////////////////////
+
+void detectBackfire(int prev, int now) {
+  if (!config->enableBackfire) return;
+
+  // Detect throttle release: was high throttle, now at neutral or low
+  if (prev > config->backfireThrottleMin && now < config->backfireReleaseMax) {
+
+    USBSerial.println("\n*** [BACKFIRE DETECTED] ***");
+    USBSerial.print("prev: "); USBSerial.print(prev);
+    USBSerial.print(" now: "); USBSerial.print(now);
+    USBSerial.print(" threshold: >"); USBSerial.print(config->backfireThrottleMin);
+    USBSerial.print(" release: <"); USBSerial.println(config->backfireReleaseMax);
+    startBurst(EFFECT_BACKFIRE, map(prev, config->backfireThrottleMin, 100, 3, 8),
+               map(prev, config->backfireThrottleMin, 100, 180, 255));
+  }
+}
+
+///////////////////////
+// BRAKE CRACKLE
+///////////////////////
+
+void detectBrakeCrackle(int prev, int now) {
+  if (!config->enableBrakeCrackle) return;
+
+  if (prev > config->brakeThrottleMin && now < config->brakeThrottleMax && !burstActive) {
+
+    USBSerial.println("\n*** [BRAKE CRACKLE DETECTED] ***");
+    USBSerial.print("prev: "); USBSerial.print(prev);
+    USBSerial.print(" now: "); USBSerial.println(now);
+    startBurst(EFFECT_BRAKE_CRACKLE, random(3, 7), random(160, 230));
+  }
+}
+
+///////////////////////
+// HANDLE BURST (NON BLOCKING)
+///////////////////////
+
+// Flashes 20-80 ms apart, each one an effect timer
+void startBurst(uint8_t source, int count, int intensity) {
+  burstActive = true;
+  burstEffect = source;
+  burstCount = count;
+  burstIntensity = intensity;
+  scheduleEffectTimer(TIMER_BURST, random(20, 80));
+}
+
+// Effect timer: one flash, or the end of the burst
+void burstStep() {
+  if (!burstActive) return;
+
+  if (burstCount > 0) {
+
+    // Backfire colors: blue, purple, red, orange at random (one shade each below full detail)
+    int colorChoice = random(0, 10);
+    CRGB color;
+    
+    if (frameTier != TIER_FULL) {
+      static const CRGB fixedShades[] = { CRGB(25, 100, 220), CRGB(150, 40, 200), CRGB(255, 100, 15), CRGB(255, 200, 50) };
+      color = fixedShades[(colorChoice >= 2) + (colorChoice >= 4) + (colorChoice >= 7)];
+    } else if (colorChoice < 2) {
+      // Blue flame (hot combustion)
+      color = CRGB(random(0, 50), random(50, 150), random(180, 255));
+    } else if (colorChoice < 4) {
+      // Purple flame (fuel-rich)
+      color = CRGB(random(100, 200), random(0, 80), random(150, 255));
+    } else if (colorChoice < 7) {
+      // Red-orange (unburned fuel)
+      color = CRGB(255, random(50, 150), random(0, 30));
+    } else {
+      // Bright orange-yellow (hot flash)
+      color = CRGB(255, random(150, 255), random(0, 100));
+    }
+    
+    fill_solid(leds, NUM_LEDS, color);
+    burstCount--;
+    scheduleEffectTimer(TIMER_BURST, random(20, 80));
+
+  } else {
+
+    // Fully turn off LEDs after burst completes
+    fill_solid(leds, NUM_LEDS, CRGB::Black);
+    burstActive = false;
+  }
+}
+
+///////////////////////
+// IDLE BURBLE
+///////////////////////
+
+// Burbles are scheduled as a Poisson process (exponential gaps) so the idle loop can
+// sleep until the next one is due instead of rolling a chance every frame
+void scheduleNextBurble() {
+  float u = random(1, 10001) / 10000.0f;
+  scheduleEffectTimer(TIMER_BURBLE, (uint32_t)(-logf(u) * BURBLE_MEAN_INTERVAL_MS));
+}
+
+// Effect timer: the burble itself waits for the frame's throttle
+void burbleFired() {
+  burbleDue = true;
+}
+
+void idleBurble(int throttle) {
+  if (!config->enableIdleBurble) {
+    burbleDue = false;
+    timerCancel(effectTimers, TIMER_BURBLE);
+    return;
+  }
+  if (!burbleDue) {
+    if (!timerPending(effectTimers, TIMER_BURBLE)) scheduleNextBurble();
+    return;
+  }
+  if (burstActive) return;
+
+  burbleDue = false;
+  if (abs(throttle) < 5) {
+    setFlame(random(100, 160));
+    telemetryBack().activeEffects |= 1 << EFFECT_IDLE_BURBLE;
+  }
+  scheduleNextBurble();
+}
+
+///////////////////////
+// STICK GESTURES
+///////////////////////
+
+uint8_t configEffects(const RenderConfig& c) {
+  return (c.enableBackfire ? EFFECT_BIT(EFFECT_BACKFIRE) : 0) |
+         (c.enableBrakeCrackle ? EFFECT_BIT(EFFECT_BRAKE_CRACKLE) : 0) |
+         (c.enableIdleBurble ? EFFECT_BIT(EFFECT_IDLE_BURBLE) : 0) |
+         (c.enableRPMFlicker ? EFFECT_BIT(EFFECT_RPM_FLICKER) : 0);
+}
+
+void setConfigEffects(RenderConfig& c, uint8_t effects) {
+  c.enableBackfire = effects & EFFECT_BIT(EFFECT_BACKFIRE);
+  c.enableBrakeCrackle = effects & EFFECT_BIT(EFFECT_BRAKE_CRACKLE);
+  c.enableIdleBurble = effects & EFFECT_BIT(EFFECT_IDLE_BURBLE);
+  c.enableRPMFlicker = effects & EFFECT_BIT(EFFECT_RPM_FLICKER);
+}
+
+void showGestureFeedback(CRGB colour) {
+  gestureFeedbackColour = colour;
+  gestureFeedbackActive = true;
+  scheduleEffectTimer(TIMER_GESTURE_FEEDBACK, GESTURE_FEEDBACK_MS);
+}
+
+// Effect timer
+void endGestureFeedback() {
+  gestureFeedbackActive = false;
+}
+
+// Frame pipeline: act on a recognised gesture (effect changes publish a new config,
+// which the loop then saves like a web change)
+void applyGesture(Gesture gesture) {
+  if (gesture == GESTURE_NONE) return;
+  USBSerial.print("[Gesture] ");
+  USBSerial.println(GESTURE_NAMES[gesture]);
+  
+  if (gesture == GESTURE_TRIPLE_BLIP) {
+    // Next effect preset
+    uint8_t next = (effectPresetIndex + 1) % EFFECT_PRESET_COUNT;
+    uint8_t effects = EFFECT_PRESETS[next].effects;
+    if (!updateConfig([effects](RenderConfig& c) { setConfigEffects(c, effects); })) {
+      USBSerial.println("[Gesture] Config busy - try again");
+      return;
+    }
+    effectPresetIndex = next;
+    mutedEffects = 0;
+    USBSerial.print("[Gesture] Preset: ");
+    USBSerial.println(EFFECT_PRESETS[next].name);
+    showGestureFeedback(EFFECT_PRESETS[next].colour);
+  } else if (gesture == GESTURE_TRIPLE_BRAKE_BLIP) {
+    // Effects off, or back to what they were
+    uint8_t current = configEffects(*config);
+    uint8_t effects = current ? 0 : (mutedEffects ? mutedEffects : ALL_EFFECTS);
+    if (!updateConfig([effects](RenderConfig& c) { setConfigEffects(c, effects); })) {
+      USBSerial.println("[Gesture] Config busy - try again");
+      return;
+    }
+    mutedEffects = current;
+    USBSerial.println(effects ? "[Gesture] Effects on" : "[Gesture] Effects off");
+    showGestureFeedback(effects ? CRGB(0, 255, 0) : CRGB(255, 0, 0));
+  } else if (gesture == GESTURE_BRAKE_HOLD) {
+    // Radio back on (no-op while it is on)
+    if (radioOn || inAPMode) return;
+    radioWakeRequested = true;
+    showGestureFeedback(CRGB(0, 0, 255));
+  }
+}
+
+// Solid confirmation colour for a moment after a gesture, over whatever the effects drew
+void drawGestureFeedback() {
+  if (!gestureFeedbackActive) return;
+  fill_solid(leds, NUM_LEDS, gestureFeedbackColour);
+}
+
+///////////////////////
+// FLAME COLOR MODEL
 ///////////////////////
 
-void detectBackfire(int prev, int now) {
-  if (!enableBackfire) return;
+void setFlame(int heat) {
 
-  // Detect throttle release: was high throttle, now at neutral or low
-  if (prev > backfireThrottleMin && now < backfireReleaseMax) {
+  heat = constrain(heat, 0, 255);
 
-    USBSerial.println("\n*** [BACKFIRE DETECTED] ***");
-    USBSerial.print("prev: "); USBSerial.print(prev);
-    USBSerial.print(" now: "); USBSerial.print(now);
-    USBSerial.print(" threshold: >"); USBSerial.print(backfireThrottleMin);
-    USBSerial.print(" release: <"); USBSerial.println(backfireReleaseMax);
-    burstActive = true;
-    burstCount = map(prev, backfireThrottleMin, 100, 3, 8);
-    burstIntensity = map(prev, backfireThrottleMin, 100, 180, 255);
-    lastEffectTime = millis();
+  CRGB color;
+
+  if (heat < 120) {
+    color = CRGB(heat, heat / 4, 0);               // deep red
+  }
+  else if (heat < 200) {
+    color = CRGB(255, heat, 0);                    // orange
+  }
+  else {
+    color = CRGB(255, 255, heat - 200);            // yellow-white tip
+  }
+
+  for (int i = 0; i < NUM_LEDS; i++) {
+    leds[i] = color;
   }
 }
 
 ///////////////////////
-// BRAKE CRACKLE
+// API RESPONSES
 ///////////////////////
 
-void detectBrakeCrackle(int prev, int now) {
-  if (!enableBrakeCrackle) return;
+// Every JSON response is formatted into this one static buffer, so serving a
+// request never touches the heap from our side
+#define RESPONSE_BUFFER_SIZE 4096
+char responseBuffer[RESPONSE_BUFFER_SIZE];
+size_t responseLength = 0;
+bool responseOverflow = false;
+
+void responseBegin() {
+  responseLength = 0;
+  responseOverflow = false;
+  responseBuffer[0] = '\0';
+}
+
+void responseAppend(const char* fmt, ...) {
+  if (responseOverflow) return;
+  
+  va_list args;
+  va_start(args, fmt);
+  int written = vsnprintf(responseBuffer + responseLength, RESPONSE_BUFFER_SIZE - responseLength, fmt, args);
+  va_end(args);
+  
+  if (written < 0 || responseLength + written >= RESPONSE_BUFFER_SIZE) {
+    responseOverflow = true;
+    return;
+  }
+  responseLength += written;
+}
 
-  if (prev > brakeThrottleMin && now < brakeThrottleMax && !burstActive) {
+// Append a string with JSON quote/backslash escaping (control characters dropped)
+void responseAppendEscaped(const char* str) {
+  for (const char* c = str; *c && !responseOverflow; c++) {
+    if ((uint8_t)*c < 0x20) continue;
+    if (responseLength + 2 >= RESPONSE_BUFFER_SIZE) {
+      responseOverflow = true;
+      return;
+    }
+    if (*c == '"' || *c == '\\') responseBuffer[responseLength++] = '\\';
+    responseBuffer[responseLength++] = *c;
+  }
+  responseBuffer[responseLength] = '\0';
+}
 
-    USBSerial.println("\n*** [BRAKE CRACKLE DETECTED] ***");
-    USBSerial.print("prev: "); USBSerial.print(prev);
-    USBSerial.print(" now: "); USBSerial.println(now);
-    burstActive = true;
-    burstCount = random(3, 7);
-    burstIntensity = random(160, 230);
-    lastEffectTime = millis();
+void sendResponse(int code, const char* contentType) {
+  if (responseOverflow) {
+    USBSerial.println("[Web] Response buffer overflow");
+    server.send_P(500, "text/plain", "Response too large");
+    return;
   }
+  server.send(code, contentType, responseBuffer, responseLength);  // Copied: the buffer is reused
 }
 
-///////////////////////
-// HANDLE BURST (NON BLOCKING)
-///////////////////////
+// Copy the string value of "key" out of a flat JSON object; false if missing or too long
+bool extractJsonString(const char* json, const char* key, char* out, size_t outSize) {
+  char pattern[24];
+  snprintf(pattern, sizeof(pattern), "\"%s\":\"", key);
+  const char* start = strstr(json, pattern);
+  if (start == nullptr) return false;
+  start += strlen(pattern);
+  
+  const char* end = strchr(start, '"');
+  if (end == nullptr || (size_t)(end - start) >= outSize) return false;
+  
+  memcpy(out, start, end - start);
+  out[end - start] = '\0';
+  return true;
+}
 
-void handleBurst() {
+// Streamed straight into the connection's send buffer by sendJson() (see json_writer.h):
+// typed fields instead of format strings, and no copy. A body past the buffer goes out as chunks.
+bool flushJsonChunk(void*, size_t length) {
+  return server.flushBody(length);
+}
 
-  if (!burstActive) return;
+template <typename Writer>
+void sendJson(int code, Writer write) {
+  size_t capacity;
+  char* body = server.beginBody(code, "application/json", &capacity);
+  if (body == nullptr) return;
+  
+  JsonWriter json(body, capacity, flushJsonChunk);
+  write(json);
+  if (json.overflowed()) USBSerial.println("[Web] Response cut short");
+  server.endBody(json.length(), !json.overflowed());
+}
 
-  if (millis() - lastEffectTime > random(20, 80)) {
+void writeScanJson(JsonWriter& json) {
+  json.beginObject();
+  json.field("scanning", scanInProgress);
+  json.field("age", scanResultTime == 0 ? 0UL : millis() - scanResultTime);
+  json.key("networks").beginArray();
+  for (int i = 0; i < scanResultCount; i++) {
+    json.beginObject();
+    json.field("ssid", (const char*)scanResults[i].ssid);
+    json.field("rssi", (int)scanResults[i].rssi);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
 
-    if (burstCount > 0) {
+void writeStatusJson(JsonWriter& json) {
+  // What the pipeline rendered last frame - no recomputation here
+  Telemetry t = readTelemetry();
+  
+  unsigned long upSeconds = millis() / 1000;
+  IPAddress ip = WiFi.localIP();
+  
+  json.beginObject();
+  json.key("ip").valuef("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  json.key("uptime").valuef("%lud %luh %lum %lus",
+                            upSeconds / 86400, (upSeconds % 86400) / 3600, (upSeconds % 3600) / 60, upSeconds % 60);
+  json.field("rssi", (int)WiFi.RSSI());
+  json.field("pwm", t.pulse);
+  json.field("throttle", t.throttle);
+  json.field("burst", t.burstActive ? "YES" : "NO");
+  json.field("frame", t.frame);
+  json.key("led").valuef("#%02X%02X%02X", t.led.r, t.led.g, t.led.b);
+  json.field("detail", TIER_NAMES[t.detailTier]);
+  json.field("latencyUs", t.latencyUs);
+  json.field("frameUs", t.frameDtUs);
+  json.field("workUs", t.workUs);
+  json.endObject();
+}
 
-      // Backfire colors: blue, purple, red, orange at random
-      int colorChoice = random(0, 10);
-      CRGB color;
-      
-      if (colorChoice < 2) {
-        // Blue flame (hot combustion)
-        color = CRGB(random(0, 50), random(50, 150), random(180, 255));
-      } else if (colorChoice < 4) {
-        // Purple flame (fuel-rich)
-        color = CRGB(random(100, 200), random(0, 80), random(150, 255));
-      } else if (colorChoice < 7) {
-        // Red-orange (unburned fuel)
-        color = CRGB(255, random(50, 150), random(0, 30));
-      } else {
-        // Bright orange-yellow (hot flash)
-        color = CRGB(255, random(150, 255), random(0, 100));
-      }
-      
-      fill_solid(leds, NUM_LEDS, color);
-      burstCount--;
+void writeSettingsJson(JsonWriter& json) {
+  const RenderConfig& cfg = *configAcquire();
+  json.beginObject();
+  json.field("enableBackfire", cfg.enableBackfire);
+  json.field("enableBrakeCrackle", cfg.enableBrakeCrackle);
+  json.field("enableIdleBurble", cfg.enableIdleBurble);
+  json.field("enableRPMFlicker", cfg.enableRPMFlicker);
+  json.field("backfireThrottleMin", cfg.backfireThrottleMin);
+  json.field("backfireReleaseMax", cfg.backfireReleaseMax);
+  json.field("rpmFlickerThreshold", cfg.rpmFlickerThreshold);
+  json.endObject();
+}
 
-    } else {
+// Server task: the pipeline's calibration step as of its last published frame (the
+// calibrationStep global belongs to the loop task)
+CalibrationStep publishedCalibrationStep() {
+  return (CalibrationStep)readTelemetry().calibrationStep;
+}
 
-      // Fully turn off LEDs after burst completes
-      fill_solid(leds, NUM_LEDS, CRGB::Black);
-      burstActive = false;
-    }
+void writeCalibrationStatusJson(JsonWriter& json) {
+  CalibrationStep step = publishedCalibrationStep();
+  const char* stepName = "idle";
+  if (step == CAL_NEUTRAL) stepName = "neutral";
+  else if (step == CAL_THROTTLE) stepName = "throttle";
+  else if (step == CAL_BRAKE) stepName = "brake";
+  else if (step == CAL_COMPLETE) stepName = "complete";
+  
+  json.beginObject();
+  json.field("step", (int)step);
+  json.field("stepName", stepName);
+  json.endObject();
+}
 
-    lastEffectTime = millis();
+void writeCaptureJson(JsonWriter& json, int value) {
+  json.beginObject();
+  json.field("captured", true);
+  json.field("value", value);
+  json.endObject();
+}
+
+void writeCalibrationResultsJson(JsonWriter& json) {
+  const RenderConfig& cfg = *configAcquire();
+  json.beginObject();
+  json.field("min", cfg.minPulse);
+  json.field("max", cfg.maxPulse);
+  json.field("neutral", cfg.neutralPulse);
+  json.field("neutral_min", cfg.neutralMin);
+  json.field("neutral_max", cfg.neutralMax);
+  json.endObject();
+}
+
+void buildMetricsJson() {
+  float cyclesPerUs = PROFILE_REF_MHZ;    // Stage histograms hold normalised cycles
+  
+  responseBegin();
+  responseAppend("{\"cpuMHz\":%d,", (int)ESP.getCpuFreqMHz());
+  responseAppend("\"frameHz\":%.1f,", frameRateHz);
+  
+  // Spare time per frame on the loop's core at the current frame rate (handlers run on
+  // the server task, so not the current core)
+  float loopHeadroom = 1.0f - coreLoad[loopCore].load;
+  responseAppend("\"frameHeadroomUs\":%.0f,", frameRateHz > 0 ? loopHeadroom * 1e6f / frameRateHz : 0);
+  responseAppend("\"cpuLoad\":{\"source\":\"%s\",\"loopCore\":%d,\"cores\":[", CPU_LOAD_SOURCE, (int)loopCore);
+  for (int core = 0; core < portNUM_PROCESSORS; core++) {
+    responseAppend("%s{\"load\":%.3f,", core > 0 ? "," : "", coreLoad[core].load);
+    responseAppend("\"headroom\":%.3f,", 1.0f - coreLoad[core].load);
+    responseAppend("\"peak\":%.3f}", coreLoad[core].peakLoad);
+  }
+  responseAppend("]},");
+  
+  // Governor: current tier, frames per tier and the learned costs it predicts with
+  responseAppend("\"detail\":{\"tier\":\"%s\",\"frames\":{", TIER_NAMES[frameTier]);
+  for (int tier = 0; tier < TIER_COUNT; tier++) {
+    responseAppend("%s\"%s\":%lu", tier > 0 ? "," : "", TIER_NAMES[tier], (unsigned long)tierFrames[tier]);
   }
+  responseAppend("},\"baseUs\":%.1f,\"costUs\":{", frameBaseCostUs);
+  for (size_t i = 0; i < sizeof(effectCosts) / sizeof(effectCosts[0]); i++) {
+    const EffectCost& effect = effectCosts[i];
+    responseAppend("%s\"%s\":[%.1f,%.1f,%.1f]", i > 0 ? "," : "", STAGE_NAMES[effect.stage],
+                   effect.costUs[TIER_FULL], effect.costUs[TIER_REDUCED], effect.costUs[TIER_MINIMAL]);
+  }
+  responseAppend("}},");
+  responseAppend("\"frameMode\":\"%s\",", idleMode ? "idle" : (fastFrames ? "fast" : "steady"));
+  responseAppend("\"frameWakes\":{\"pulse\":%lu,\"deadline\":%lu,\"phaseLocked\":%lu},",
+                 (unsigned long)pulseFrames, (unsigned long)deadlineFrames, (unsigned long)phaseLockedFrames);
+  float avgLatency = edgeToOutput.count ? (float)edgeToOutput.sumUs / edgeToOutput.count : 0;
+  responseAppend("\"edgeToOutputUs\":{\"last\":%lu,\"avg\":%.1f,\"max\":%lu},",
+                 (unsigned long)edgeToOutput.lastUs, avgLatency, (unsigned long)edgeToOutput.maxUs);
+  responseAppend("\"timersFired\":{\"effect\":%lu,\"housekeeping\":%lu},",
+                 (unsigned long)effectTimers.fired, (unsigned long)housekeepingTimers.fired);
+  // Static UI transfer: bytes actually sent next to what uncompressed, uncached loads would have cost
+  responseAppend("\"assets\":{");
+  for (int i = 0; i < WEB_ASSET_COUNT; i++) {
+    const AssetStats& a = assetStats[i];
+    uint32_t loads = a.sent + a.notModified;
+    responseAppend("%s\"%s\":{\"sent\":%lu,\"notModified\":%lu,\"bytes\":%lu,\"uncompressedBytes\":%lu,\"avgUs\":%.1f,\"maxUs\":%lu}",
+                   i > 0 ? "," : "", WEB_ASSETS[i].name, (unsigned long)a.sent, (unsigned long)a.notModified,
+                   (unsigned long)a.bytes, (unsigned long)(loads * WEB_ASSETS[i].rawLength),
+                   loads ? (float)a.totalUs / loads : 0.0f, (unsigned long)a.maxUs);
+  }
+  responseAppend("},");
+  const HttpStats& http = server.stats();
+  responseAppend("\"http\":{\"active\":%u,\"peakActive\":%u,\"accepted\":%lu,\"requests\":%lu,\"keepAliveReuses\":%lu,"
+                 "\"evicted\":%lu,\"timeouts\":%lu,\"rejected\":%lu,\"bytesIn\":%lu,\"bytesOut\":%lu,"
+                 "\"handlerAvgUs\":%.1f,\"handlerMaxUs\":%lu,\"eventStreams\":%u,\"eventsSent\":%lu,\"eventsDropped\":%lu,"
+                 "\"chunked\":%lu,\"truncated\":%lu},",
+                 http.active, http.peakActive, (unsigned long)http.accepted, (unsigned long)http.requests,
+                 (unsigned long)http.keepAliveReuses, (unsigned long)http.evicted, (unsigned long)http.timeouts,
+                 (unsigned long)http.rejected, (unsigned long)http.bytesIn, (unsigned long)http.bytesOut,
+                 http.requests ? (float)http.handlerUsTotal / http.requests : 0.0f, (unsigned long)http.handlerUsMax,
+                 http.eventStreams, (unsigned long)http.eventsSent, (unsigned long)http.eventsDropped,
+                 (unsigned long)http.chunked, (unsigned long)http.truncated);
+  responseAppend("\"stages\":{");
+  for (int i = 0; i < STAGE_COUNT; i++) {
+    const StageProfile& p = stageProfiles[i];
+    responseAppend("%s\"%s\":{", i > 0 ? "," : "", STAGE_NAMES[i]);
+    responseAppend("\"count\":%lu,", (unsigned long)p.count);
+    responseAppend("\"p50\":%.2f,", stagePercentile(p, 0.50f) / cyclesPerUs);
+    responseAppend("\"p99\":%.2f,", stagePercentile(p, 0.99f) / cyclesPerUs);
+    responseAppend("\"max\":%.2f}", p.maxCycles / cyclesPerUs);
+  }
+  responseAppend("}}");
 }
 
-///////////////////////
-// IDLE BURBLE
-///////////////////////
+void buildDeadlinesJson() {
+  responseBegin();
+  responseAppend("{\"deadlineUs\":{\"fast\":%d,\"steady\":%d},", FRAME_PERIOD_FAST_MS * 1000, FRAME_PERIOD_STEADY_MS * 1000);
+  responseAppend("\"misses\":%lu,", (unsigned long)deadlineMissCount);
+  responseAppend("\"frameStalls\":%lu,\"maxStallUs\":%lu,", (unsigned long)frameStalls, (unsigned long)maxFrameStallUs);
+  CaptureState capture = readCapture();
+  responseAppend("\"pulses\":%lu,\"lostPulses\":%lu,", (unsigned long)capture.frame, (unsigned long)capture.lostPulses);
+  responseAppend("\"flashCommits\":%lu,\"maxCommitUs\":%lu,", (unsigned long)flashCommits, (unsigned long)maxFlashCommitUs);
+  if (lastResetStage >= 0) {
+    responseAppend("\"watchdogResetStage\":\"%s\",", STAGE_NAMES[lastResetStage]);
+  } else {
+    responseAppend("\"watchdogResetStage\":null,");
+  }
+  if (lastResetHandler[0] != '\0') {
+    responseAppend("\"watchdogResetHandler\":\"%s\",", lastResetHandler);
+  } else {
+    responseAppend("\"watchdogResetHandler\":null,");
+  }
+  responseAppend("\"recent\":[");
+  
+  // Newest first
+  uint32_t logged = min<uint32_t>(deadlineMissCount, DEADLINE_LOG_SIZE);
+  for (uint32_t i = 0; i < logged; i++) {
+    const DeadlineMiss& miss = deadlineLog[(deadlineMissCount - 1 - i) % DEADLINE_LOG_SIZE];
+    responseAppend("%s{\"t\":%lu,", i > 0 ? "," : "", (unsigned long)miss.timeMs);
+    responseAppend("\"deadlineUs\":%lu,", (unsigned long)miss.deadlineUs);
+    responseAppend("\"us\":%lu,", (unsigned long)miss.durationUs);
+    responseAppend("\"stage\":\"%s\",", STAGE_NAMES[miss.stage]);
+    responseAppend("\"stageUs\":%lu}", (unsigned long)miss.stageUs);
+  }
+  responseAppend("]}");
+}
 
-void idleBurble(int throttle) {
-  if (!enableIdleBurble) return;
-  if (burstActive) return;
+void buildPowerJson() {
+  float avgTimerWake = powerStats.timerWakeCount ? (float)powerStats.timerWakeLatencySumUs / powerStats.timerWakeCount : 0;
+  float avgEdgeWake = powerStats.edgeWakeCount ? (float)powerStats.edgeWakeLatencySumUs / powerStats.edgeWakeCount : 0;
+  
+  responseBegin();
+  responseAppend("{\"mode\":\"%s\",", POWER_MODE_NAMES[powerMode]);
+  responseAppend("\"idle\":%s,", idleMode ? "true" : "false");
+  responseAppend("\"cpuMHz\":%lu,", (unsigned long)ESP.getCpuFreqMHz());
+  responseAppend("\"idleEntries\":%lu,", (unsigned long)powerStats.idleEntries);
+  responseAppend("\"activeFraction\":%.3f,", powerStats.activeFraction);
+  responseAppend("\"idleFraction\":%.3f,", powerStats.idleFraction);
+  responseAppend("\"sleepFraction\":%.3f,", powerStats.sleepFraction);
+  responseAppend("\"estCurrentMa\":%.1f,", powerStats.estCurrentMa);
+  responseAppend("\"timerWakeLatencyUs\":{\"avg\":%.1f,\"max\":%lu},", avgTimerWake, (unsigned long)powerStats.timerWakeLatencyMaxUs);
+  responseAppend("\"edgeWakeLatencyUs\":{\"avg\":%.1f,\"max\":%lu},", avgEdgeWake, (unsigned long)powerStats.edgeWakeLatencyMaxUs);
+  responseAppend("\"discardedPulses\":%lu}", (unsigned long)powerStats.discardedPulses);
+}
 
-  if (abs(throttle) < 5) {
-    if (random(0, 1000) < 4) {
-      setFlame(random(100, 160));
-    }
+void appendRadioStats(const char* name, const RadioStateStats& stats) {
+  float avgJitter = stats.periods ? (float)stats.periodJitterSumUs / stats.periods : 0;
+  float avgLatency = stats.latencyCount ? (float)stats.latencySumUs / stats.latencyCount : 0;
+  float avgCurrent = stats.seconds ? stats.currentSumMa / stats.seconds : 0;
+  responseAppend("\"%s\":{\"seconds\":%lu,", name, (unsigned long)stats.seconds);
+  responseAppend("\"periodJitterUs\":{\"avg\":%.1f,\"max\":%lu},", avgJitter, (unsigned long)stats.periodJitterMaxUs);
+  responseAppend("\"edgeToFrameUs\":{\"avg\":%.1f,\"max\":%lu},", avgLatency, (unsigned long)stats.latencyMaxUs);
+  responseAppend("\"estCurrentMa\":%.1f}", avgCurrent);
+}
+
+void buildRadioJson() {
+  responseBegin();
+  responseAppend("{\"radio\":\"%s\",", radioOn ? "on" : "off");
+  responseAppend("\"idleOffMin\":%u,", radioIdleOffMinutes.load());
+  responseAppend("\"idleForS\":%lu,", (millis() - lastWebRequestTime) / 1000);
+  responseAppend("\"stateForS\":%lu,", (millis() - radioStateSince) / 1000);
+  appendRadioStats("on", radioStats[0]);
+  responseAppend(",");
+  appendRadioStats("off", radioStats[1]);
+  responseAppend("}");
+}
+
+void buildEventsJson() {
+  const HttpStats& http = server.stats();
+  responseBegin();
+  responseAppend("{\"hz\":%u,\"maxHz\":%d,", eventRateHz, EVENT_RATE_MAX_HZ);
+  responseAppend("\"streams\":%u,\"maxStreams\":%d,", http.eventStreams, HTTP_MAX_EVENT_STREAMS);
+  responseAppend("\"sent\":%lu,\"dropped\":%lu}", (unsigned long)http.eventsSent, (unsigned long)http.eventsDropped);
+}
+
+void buildUdpJson() {
+  responseBegin();
+  responseAppend("{\"streaming\":%s,", udpStreaming ? "true" : "false");
+  responseAppend("\"host\":\"%u.%u.%u.%u\",\"port\":%u,", udpHost[0], udpHost[1], udpHost[2], udpHost[3], udpPort);
+  responseAppend("\"recordBytes\":%u,\"datagrams\":%lu,\"records\":%lu,", (unsigned)sizeof(UdpRecord),
+                 (unsigned long)udpDatagrams, (unsigned long)udpRecordsSent);
+  responseAppend("\"dropped\":%lu,\"sendErrors\":%lu}", (unsigned long)(udpDropped - udpDroppedAtStart),
+                 (unsigned long)udpSendErrors);
+}
+
+void buildMemoryJson() {
+  uint32_t freeHeap = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  uint32_t largestBlock = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  
+  responseBegin();
+  responseAppend("{\"freeHeap\":%lu,", (unsigned long)freeHeap);
+  responseAppend("\"largestBlock\":%lu,", (unsigned long)largestBlock);
+  responseAppend("\"minFreeHeap\":%lu,", (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_8BIT));
+  responseAppend("\"fragmentation\":%.3f,", heapFragmentation(freeHeap, largestBlock));
+  responseAppend("\"sampleIntervalMs\":%d,", MEMORY_SAMPLE_INTERVAL_MS);
+  responseAppend("\"taskCount\":%u,", taskCountTotal);
+  responseAppend("\"tasks\":[");
+  for (int i = 0; i < taskStackCount; i++) {
+    responseAppend(i > 0 ? ",{\"name\":\"" : "{\"name\":\"");
+    responseAppendEscaped(taskStacks[i].name);
+    responseAppend("\",\"stackFree\":%lu}", (unsigned long)taskStacks[i].stackFreeBytes);
   }
+  
+  // Oldest first, as [timeMs, freeHeap, largestBlock, minFreeHeap]
+  responseAppend("],\"history\":[");
+  uint32_t stored = min<uint32_t>(memorySampleCount, MEMORY_HISTORY_SIZE);
+  for (uint32_t i = 0; i < stored; i++) {
+    const MemorySample& sample = memoryHistory[(memorySampleCount - stored + i) % MEMORY_HISTORY_SIZE];
+    responseAppend("%s[%lu,%lu,%lu,%lu]", i > 0 ? "," : "", (unsigned long)sample.timeMs,
+                   (unsigned long)sample.freeHeap, (unsigned long)sample.largestBlock, (unsigned long)sample.minFreeHeap);
+  }
+  responseAppend("]}");
 }
 
-///////////////////////
-// FLAME COLOR MODEL
-///////////////////////
+#ifdef AFTERFIRE_DIAGNOSTICS
+// Send 10,000 requests through the running web server over loopback and check the heap
+// did not move. Every request goes the whole way: lwIP, HttpServer's parser and routing,
+// the firmware's handler and the response back over the socket.
+#define HEAP_SOAK_REQUESTS 10000
+#define HEAP_SOAK_WARMUP 100         // Requests before the baseline (the first ones settle lwIP's buffers)
+#define HEAP_SOAK_TOLERANCE 512      // bytes of drift allowed (WiFi/lwIP allocate in the background)
+
+struct SoakRequest {
+  const char* request;
+  int status;
+};
+
+// Every route that only reads state (the large pages excepted), a malformed form and a miss
+const SoakRequest SOAK_STATION_REQUESTS[] = {
+  { "GET /api/status HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/settings HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/calibrate/status HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/calibrate/results HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/metrics HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/deadlines HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/memory HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/power HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/radio HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/events/rate HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/udp HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/threshold?param=soak&value=1 HTTP/1.1\r\n\r\n", 200 },
+  { "GET /api/soak-missing HTTP/1.1\r\n\r\n", 404 },
+};
+const SoakRequest SOAK_AP_REQUESTS[] = {
+  { "GET /api/scan-networks HTTP/1.1\r\n\r\n", 200 },
+  { "POST /api/wifi/save HTTP/1.1\r\nContent-Type: application/json\r\nContent-Length: 29\r\n\r\n"
+    "{\"ssid\":\"soak\",\"password\":\"\"}", 400 },
+  { "GET /api/soak-missing HTTP/1.1\r\n\r\n", 404 },
+};
+
+char soakRx[1024];                   // Received bytes not yet consumed
+size_t soakRxLength = 0;
+
+bool soakFill(int fd) {
+  if (soakRxLength == sizeof(soakRx)) return false;
+  int n = recv(fd, soakRx + soakRxLength, sizeof(soakRx) - soakRxLength, 0);
+  if (n <= 0) return false;
+  soakRxLength += n;
+  return true;
+}
 
-void setFlame(int heat) {
+void soakConsume(size_t length) {
+  memmove(soakRx, soakRx + length, soakRxLength - length);
+  soakRxLength -= length;
+}
 
-  heat = constrain(heat, 0, 255);
+// Next CRLF-terminated line, NUL-terminated in place; its length, or -1
+int soakLine(int fd) {
+  for (;;) {
+    char* end = (char*)memmem(soakRx, soakRxLength, "\r\n", 2);
+    if (end) {
+      *end = '\0';
+      return end - soakRx;
+    }
+    if (!soakFill(fd)) return -1;
+  }
+}
 
-  CRGB color;
+bool soakSkip(int fd, size_t length) {
+  while (length > 0) {
+    if (soakRxLength == 0 && !soakFill(fd)) return false;
+    size_t n = min(length, soakRxLength);
+    soakConsume(n);
+    length -= n;
+  }
+  return true;
+}
 
-  if (heat < 120) {
-    color = CRGB(heat, heat / 4, 0);               // deep red
+// Read one whole response, fixed length or chunked; its status code, or -1
+int soakReadResponse(int fd) {
+  int status = -1;
+  size_t length = 0;
+  bool chunked = false;
+  for (bool first = true;; first = false) {
+    int line = soakLine(fd);
+    if (line < 0) return -1;
+    if (first) status = atoi(soakRx + 9);
+    else if (strncasecmp(soakRx, "Content-Length:", 15) == 0) length = strtoul(soakRx + 15, nullptr, 10);
+    else if (strncasecmp(soakRx, "Transfer-Encoding: chunked", 26) == 0) chunked = true;
+    soakConsume(line + 2);
+    if (line == 0) break;
   }
-  else if (heat < 200) {
-    color = CRGB(255, heat, 0);                    // orange
+  if (!chunked) return soakSkip(fd, length) ? status : -1;
+  for (;;) {
+    int line = soakLine(fd);
+    if (line < 0) return -1;
+    size_t size = strtoul(soakRx, nullptr, 16);
+    soakConsume(line + 2);
+    if (!soakSkip(fd, size + 2)) return -1;
+    if (size == 0) return status;
   }
-  else {
-    color = CRGB(255, 255, heat - 200);            // yellow-white tip
+}
+
+// Runs on the loop task as a client of the server task, so the server must be running
+void runHeapSoakCheck() {
+  bool station = wifiState == WIFI_STATE_CONNECTED;
+  const SoakRequest* requests = station ? SOAK_STATION_REQUESTS : SOAK_AP_REQUESTS;
+  size_t kinds = station ? sizeof(SOAK_STATION_REQUESTS) / sizeof(SOAK_STATION_REQUESTS[0])
+                         : sizeof(SOAK_AP_REQUESTS) / sizeof(SOAK_AP_REQUESTS[0]);
+  USBSerial.printf("[Diag] Heap soak: %d requests through the web server\n", HEAP_SOAK_REQUESTS);
+  
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(80);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (fd < 0 || connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    USBSerial.println("[Diag] Heap soak: FAIL (could not connect to the server)");
+    if (fd >= 0) close(fd);
+    return;
+  }
+  struct timeval timeout = { 5, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  soakRxLength = 0;
+  
+  size_t freeBefore = 0;
+  size_t largestBefore = 0;
+  for (int i = 0; i < HEAP_SOAK_WARMUP + HEAP_SOAK_REQUESTS; i++) {
+    if (i == HEAP_SOAK_WARMUP) {
+      freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+      largestBefore = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+    }
+    const SoakRequest& request = requests[i % kinds];
+    size_t length = strlen(request.request);
+    int status = send(fd, request.request, length, 0) == (int)length ? soakReadResponse(fd) : -1;
+    if (status != request.status) {
+      USBSerial.printf("[Diag] Heap soak: FAIL (request %d answered %d, expected %d)\n", i, status, request.status);
+      close(fd);
+      return;
+    }
   }
+  
+  size_t freeAfter = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+  size_t largestAfter = heap_caps_get_largest_free_block(MALLOC_CAP_8BIT);
+  close(fd);
+  long freeDrift = (long)freeBefore - (long)freeAfter;
+  long largestDrift = (long)largestBefore - (long)largestAfter;
+  bool pass = freeDrift <= HEAP_SOAK_TOLERANCE && largestDrift <= HEAP_SOAK_TOLERANCE;
+  
+  USBSerial.printf("[Diag] Heap soak: free %u -> %u, largest block %u -> %u: %s\n",
+                   (unsigned)freeBefore, (unsigned)freeAfter, (unsigned)largestBefore, (unsigned)largestAfter,
+                   pass ? "PASS" : "FAIL");
+}
 
-  for (int i = 0; i < NUM_LEDS; i++) {
-    leds[i] = color;
+// Time each streamed response over 1,000 builds and watch the heap across them
+#define JSON_BENCH_REQUESTS 1000
+
+void runJsonWriterCheck() {
+  struct Bench {
+    const char* name;
+    void (*write)(JsonWriter& json);
+  };
+  static const Bench BENCHES[] = {
+    { "scan-networks", writeScanJson },
+    { "status", writeStatusJson },
+    { "settings", writeSettingsJson },
+    { "calibrate/status", writeCalibrationStatusJson },
+    { "calibrate/results", writeCalibrationResultsJson },
+    { "calibrate/capture", [](JsonWriter& json) { writeCaptureJson(json, 1500); } },
+  };
+  
+  bool pass = true;
+  for (const Bench& bench : BENCHES) {
+    size_t freeBefore = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    size_t length = 0;
+    uint32_t start = micros();
+    for (int i = 0; i < JSON_BENCH_REQUESTS; i++) {
+      JsonWriter json(responseBuffer, RESPONSE_BUFFER_SIZE);
+      bench.write(json);
+      if (json.overflowed()) pass = false;
+      length = json.length();
+    }
+    uint32_t elapsed = micros() - start;
+    long heapDelta = (long)heap_caps_get_free_size(MALLOC_CAP_8BIT) - (long)freeBefore;
+    if (heapDelta < -HEAP_SOAK_TOLERANCE) pass = false;
+    USBSerial.printf("[Diag] JSON %-17s %4u bytes %6.1f us/response, heap %+ld\n",
+                     bench.name, (unsigned)length, (float)elapsed / JSON_BENCH_REQUESTS, heapDelta);
+    yield();
   }
+  USBSerial.printf("[Diag] JSON writer: %s\n", pass ? "PASS" : "FAIL");
 }
+#endif
 
 ///////////////////////
 // WEB SERVER
 ///////////////////////
 
+// Publish an effect toggle and answer with the requested state
+void sendEffectToggle(EffectId effect, bool enabled) {
+  bool published = updateConfig([effect, enabled](RenderConfig& c) {
+    if (effect == EFFECT_BACKFIRE) c.enableBackfire = enabled;
+    else if (effect == EFFECT_BRAKE_CRACKLE) c.enableBrakeCrackle = enabled;
+    else if (effect == EFFECT_IDLE_BURBLE) c.enableIdleBurble = enabled;
+    else if (effect == EFFECT_RPM_FLICKER) c.enableRPMFlicker = enabled;
+  });
+  if (!published) {
+    server.send_P(503, "application/json", "{\"error\":\"Busy\"}");
+    return;
+  }
+  server.send_P(200, "application/json", enabled ? "{\"enabled\":true}" : "{\"enabled\":false}");
+}
+
+// Server task, after every poll: the /api/status frame, formatted once and queued to every
+// open stream. A stream still sending the previous frame skips this one.
+void serviceEventStreams() {
+  if (server.eventStreams() == 0) return;
+  uint32_t now = millis();
+  if ((long)(now - nextEventMs) < 0) return;
+  
+  uint32_t period = 1000 / eventRateHz;
+  nextEventMs += period;
+  if ((long)(now - nextEventMs) >= 0) nextEventMs = now + period;  // First event, or fell behind
+  
+  lastWebRequestTime = now;              // An open dashboard keeps the radio on
+  static char event[512];
+  JsonWriter json(event, sizeof(event));
+  writeStatusJson(json);
+  if (!json.overflowed()) server.broadcastEvent(event, json.length());
+}
+
+
 void setupWebServer() {
   
+  // Sees every request first (drives the radio idle timeout)
+  server.onRequest(noteWebRequest);
+  lastWebRequestTime = millis();
+  server.collectHeaders(COLLECTED_HEADERS, sizeof(COLLECTED_HEADERS) / sizeof(COLLECTED_HEADERS[0]));
+  
   // Root page - Web UI
-  server.on("/", []() {
-    String html = R"=====(<!DOCTYPE html>
-<html>
-<head>
-  <meta charset="UTF-8">
-  <meta name="viewport" content="width=device-width, initial-scale=1.0">
-  <title>Afterfire Effect Monitor</title>
-  <style>
-    body {
-      font-family: 'Segoe UI', Arial, sans-serif;
-      background: linear-gradient(135deg, #1e1e1e 0%, #2d2d2d 100%);
-      color: #fff;
-      margin: 0;
-      padding: 20px;
-    }
-    .container {
-      max-width: 800px;
-      margin: 0 auto;
-    }
-    h1 {
-      text-align: center;
-      color: #ff6b35;
-      text-shadow: 0 0 10px rgba(255,107,53,0.5);
-    }
-    .card {
-      background: rgba(255,255,255,0.1);
-      border-radius: 10px;
-      padding: 20px;
-      margin: 20px 0;
-      backdrop-filter: blur(10px);
-      border: 1px solid rgba(255,255,255,0.2);
-    }
-    .stat {
-      display: flex;
-      justify-content: space-between;
-      padding: 10px 0;
-      border-bottom: 1px solid rgba(255,255,255,0.1);
-    }
-    .stat:last-child { border-bottom: none; }
-    .label { color: #aaa; }
-    .value { 
-      color: #ff6b35;
-      font-weight: bold;
-      font-size: 1.2em;
-      display: flex;
-      align-items: center;
-      justify-content: flex-end;
-    }
-    .status-ok { color: #4caf50; }
-    .status-warn { color: #ff9800; }
-    .status-error { color: #f44336; }
-    .burst-indicator {
-      display: inline-block;
-      width: 12px;
-      height: 12px;
-      border-radius: 50%;
-      margin-left: 10px;
-      background: #4caf50;
-    }
-    .burst-active {
-      background: #ff6b35;
-      animation: pulse 0.5s infinite;
-    }
-    @keyframes pulse {
-      0%, 100% { opacity: 1; }
-      50% { opacity: 0.5; }
-    }
-    button {
-      background: #ff6b35;
-      color: white;
-      border: none;
-      padding: 10px 20px;
-      border-radius: 5px;
-      cursor: pointer;
-      font-size: 16px;
-      margin: 5px;
-    }
-    button:hover { background: #ff8555; }
-    .footer {
-      text-align: center;
-      margin-top: 30px;
-      color: #888;
-      font-size: 0.9em;
-    }
-    input[type="checkbox"] {
-      width: 20px;
-      height: 20px;
-      cursor: pointer;
-      vertical-align: middle;
-      margin-right: 5px;
-    }
-    input[type="range"] {
-      width: 150px;
-      height: 6px;
-      border-radius: 5px;
-      background: rgba(255,255,255,0.2);
-      outline: none;
-      vertical-align: middle;
-      margin-right: 10px;
-      cursor: pointer;
-    }
-    input[type="range"]::-webkit-slider-thumb {
-      -webkit-appearance: none;
-      appearance: none;
-      width: 18px;
-      height: 18px;
-      border-radius: 50%;
-      background: #ff6b35;
-      cursor: pointer;
-    }
-    input[type="range"]::-moz-range-thumb {
-      width: 18px;
-      height: 18px;
-      border-radius: 50%;
-      background: #ff6b35;
-      cursor: pointer;
-      border: none;
-    }
-    .toggle-btn {
-      display: inline-block;
-      width: 50px;
-      height: 26px;
-      background: #555;
-      border-radius: 13px;
-      position: relative;
-      cursor: pointer;
-      transition: background 0.3s;
-      vertical-align: middle;
-      margin-right: 10px;
-    }
-    .toggle-btn.active {
-      background: #4caf50;
-    }
-    .toggle-btn:after {
-      content: '';
-      position: absolute;
-      width: 20px;
-      height: 20px;
-      border-radius: 50%;
-      background: white;
-      top: 3px;
-      left: 3px;
-      transition: left 0.3s;
-    }
-    .toggle-btn.active:after {
-      left: 27px;
-    }
-    .effect-status {
-      font-size: 0.9em;
-      color: #aaa;
-    }
-    .effect-status.active {
-      color: #4caf50;
-    }
-  </style>
-</head>
-<body>
-  <div class="container">
-    <h1>🔥 Afterfire Effect Monitor</h1>
-    
-    <div class="card">
-      <h2>System Status</h2>
-      <div class="stat">
-        <span class="label">Device</span>
-        <span class="value">ESP32-S3-Zero</span>
-      </div>
-      <div class="stat">
-        <span class="label">IP Address</span>
-        <span class="value" id="ip">Loading...</span>
-      </div>
-      <div class="stat">
-        <span class="label">Uptime</span>
-        <span class="value" id="uptime">Loading...</span>
-      </div>
-      <div class="stat">
-        <span class="label">WiFi Signal</span>
-        <span class="value" id="rssi">Loading...</span>
-      </div>
-    </div>
-
-    <div class="card">
-      <h2>Throttle Status</h2>
-      <div class="stat">
-        <span class="label">PWM Signal</span>
-        <span class="value" id="pwm">0 μs</span>
-      </div>
-      <div class="stat">
-        <span class="label">Throttle Position</span>
-        <span class="value" id="throttle">0%</span>
-      </div>
-      <div class="stat">
-        <span class="label">Burst Active</span>
-        <span class="value" id="burst">NO<span class="burst-indicator" id="burst-led"></span></span>
-      </div>
-    </div>
-
-    <div class="card">
-      <h2>Effect Controls</h2>
-      <div class="stat">
-        <span class="label">🔥 Backfire</span>
-        <span class="value">
-          <span class="toggle-btn" id="toggleBackfire" onclick="toggleEffectBtn('backfire')"></span>
-          <span class="effect-status" id="backfireStatus">...</span>
-        </span>
-      </div>
-      <div class="stat">
-        <span class="label">⚡ Brake Crackle</span>
-        <span class="value">
-          <span class="toggle-btn" id="toggleBrake" onclick="toggleEffectBtn('brake')"></span>
-          <span class="effect-status" id="brakeStatus">...</span>
-        </span>
-      </div>
-      <div class="stat">
-        <span class="label">💨 Idle Burble</span>
-        <span class="value">
-          <span class="toggle-btn" id="toggleIdle" onclick="toggleEffectBtn('idle')"></span>
-          <span class="effect-status" id="idleStatus">...</span>
-        </span>
-      </div>
-      <div class="stat">
-        <span class="label">🌡️ RPM Flicker</span>
-        <span class="value">
-          <span class="toggle-btn" id="toggleRpm" onclick="toggleEffectBtn('rpm')"></span>
-          <span class="effect-status" id="rpmStatus">...</span>
-        </span>
-      </div>
-    </div>
-
-    <div class="card">
-      <h2>Backfire Sensitivity</h2>
-      <div class="stat">
-        <span class="label">Throttle Min</span>
-        <span class="value"><input type="range" id="backfireMin" min="10" max="60" value="30" onchange="updateThreshold('backfireMin', this.value)"> <span id="backfireMinVal">...</span>%</span>
-      </div>
-      <div class="stat">
-        <span class="label">Release Max</span>
-        <span class="value"><input type="range" id="backfireMax" min="5" max="40" value="15" onchange="updateThreshold('backfireMax', this.value)"> <span id="backfireMaxVal">...</span>%</span>
-      </div>
-    </div>
-
-    <div class="card">
-      <h2>RPM Flicker Settings</h2>
-      <div class="stat">
-        <span class="label">Start Threshold</span>
-        <span class="value"><input type="range" id="rpmThreshold" min="0" max="100" value="10" onchange="updateThreshold('rpmThreshold', this.value)"> <span id="rpmThresholdVal">...</span>%</span>
-      </div>
-      <p style="color:#aaa; font-size:0.9em; margin-top:10px;">Throttle position where LEDs start glowing (0% = immediate, 100% = full throttle)</p>
-    </div>
-
-    <div class="card">
-      <h2>Controls</h2>
-      <button onclick="testBackfire()">🔥 Test Backfire</button>
-      <button onclick="testCrackle()">⚡ Test Crackle</button>
-      <button onclick="calibrate()" id="calibrateBtn">🎯 Calibrate (10s)</button>
-      <button onclick="location.reload()">🔄 Refresh</button>
-    </div>
-
-    <div class="card" id="calibrationCard" style="display:none; background: rgba(255,107,53,0.2);">
-      <h2>🎯 Calibration Mode</h2>
-      <div id="calStep1" style="display:none;">
-        <h3>Step 1 of 3: Neutral Position</h3>
-        <p><strong>1. Move throttle stick to CENTER/NEUTRAL position</strong></p>
-        <p><strong>2. Click "Capture Neutral" when ready</strong></p>
-        <p>Current PWM: <span id="currentPWM1" style="color:#4caf50; font-size:1.3em;">---</span> μs</p>
-        <button onclick="captureNeutral()" style="background:#4caf50; font-size:18px; padding:15px 30px;">✓ Capture Neutral</button>
-      </div>
-      <div id="calStep2" style="display:none;">
-        <h3>Step 2 of 3: Full Throttle</h3>
-        <p><strong>1. Move throttle stick to FULL FORWARD position</strong></p>
-        <p><strong>2. Click "Capture Throttle" when ready</strong></p>
-        <p>Current PWM: <span id="currentPWM2" style="color:#4caf50; font-size:1.3em;">---</span> μs</p>
-        <p style="color:#aaa;">✓ Neutral: <span id="savedNeutral">---</span> μs</p>
-        <button onclick="captureThrottle()" style="background:#4caf50; font-size:18px; padding:15px 30px;">✓ Capture Throttle</button>
-      </div>
-      <div id="calStep3" style="display:none;">
-        <h3>Step 3 of 3: Full Brake</h3>
-        <p><strong>1. Move throttle stick to FULL REVERSE/BRAKE position</strong></p>
-        <p><strong>2. Click "Capture Brake" when ready</strong></p>
-        <p>Current PWM: <span id="currentPWM3" style="color:#4caf50; font-size:1.3em;">---</span> μs</p>
-        <p style="color:#aaa;">✓ Neutral: <span id="savedNeutral2">---</span> μs</p>
-        <p style="color:#aaa;">✓ Throttle: <span id="savedThrottle">---</span> μs</p>
-        <button onclick="captureBrake()" style="background:#4caf50; font-size:18px; padding:15px 30px;">✓ Capture Brake</button>
-      </div>
-      <div id="calComplete" style="display:none;">
-        <h3>✅ Calibration Complete!</h3>
-        <p>Neutral: <span id="calNeutral">-</span> μs (±25 μs)</p>
-        <p>Full Throttle: <span id="calThrottle">-</span> μs</p>
-        <p>Full Brake: <span id="calBrake">-</span> μs</p>
-        <p><em>Reloading in 2 seconds...</em></p>
-      </div>
-    </div>
-
-    <div class="footer">
-      ESP32-S3 Afterfire Effect v1.0<br>
-      Auto-refresh every 2 seconds
-    </div>
-  </div>
-
-  <script>
-    function updateStats() {
-      fetch('/api/status')
-        .then(r => r.json())
-        .then(data => {
-          document.getElementById('ip').textContent = data.ip;
-          document.getElementById('uptime').textContent = data.uptime;
-          document.getElementById('rssi').textContent = data.rssi + ' dBm';
-          document.getElementById('pwm').textContent = data.pwm + ' μs';
-          document.getElementById('throttle').textContent = data.throttle + '%';
-          document.getElementById('burst').innerHTML = data.burst + 
-            '<span class="burst-indicator ' + (data.burst === 'YES' ? 'burst-active' : '') + '"></span>';
-        });
-    }
-    
-    function loadSettings() {
-      fetch('/api/settings')
-        .then(r => r.json())
-        .then(data => {
-          // Update toggle buttons and status
-          updateToggleUI('toggleBackfire', 'backfireStatus', data.enableBackfire);
-          updateToggleUI('toggleBrake', 'brakeStatus', data.enableBrakeCrackle);
-          updateToggleUI('toggleIdle', 'idleStatus', data.enableIdleBurble);
-          updateToggleUI('toggleRpm', 'rpmStatus', data.enableRPMFlicker);
-          
-          // Update threshold sliders
-          document.getElementById('backfireMin').value = data.backfireThrottleMin;
-          document.getElementById('backfireMinVal').textContent = data.backfireThrottleMin;
-          document.getElementById('backfireMax').value = data.backfireReleaseMax;
-          document.getElementById('backfireMaxVal').textContent = data.backfireReleaseMax;
-          document.getElementById('rpmThreshold').value = data.rpmFlickerThreshold;
-          document.getElementById('rpmThresholdVal').textContent = data.rpmFlickerThreshold;
-        });
-    }
-    
-    function updateToggleUI(btnId, statusId, isEnabled) {
-      const btn = document.getElementById(btnId);
-      const status = document.getElementById(statusId);
-      if (isEnabled) {
-        btn.classList.add('active');
-        status.classList.add('active');
-        status.textContent = 'ON';
-      } else {
-        btn.classList.remove('active');
-        status.classList.remove('active');
-        status.textContent = 'OFF';
-      }
-    }
-    
-    function testBackfire() {
-      fetch('/api/test/backfire').then(() => alert('Backfire triggered!'));
-    }
-    
-    function testCrackle() {
-      fetch('/api/test/crackle').then(() => alert('Crackle triggered!'));
-    }
-    
-    function calibrate() {
-      if (!confirm('Start manual calibration?\n\nYou will set each position individually with confirmation buttons.')) return;
-      
-      document.getElementById('calibrationCard').style.display = 'block';
-      document.getElementById('calibrateBtn').disabled = true;
-      
-      fetch('/api/calibrate/start').then(r => r.json()).then(data => {
-        if (data.status === 'started') {
-          showCalibrationStep();
-          startPWMMonitor();
-        }
-      });
-    }
-    
-    let pwmMonitorInterval = null;
-    
-    function startPWMMonitor() {
-      // Update current PWM reading every 200ms
-      pwmMonitorInterval = setInterval(() => {
-        fetch('/api/status').then(r => r.json()).then(data => {
-          document.getElementById('currentPWM1').textContent = data.pwm;
-          document.getElementById('currentPWM2').textContent = data.pwm;
-          document.getElementById('currentPWM3').textContent = data.pwm;
-        });
-      }, 200);
-    }
-    
-    function stopPWMMonitor() {
-      if (pwmMonitorInterval) {
-        clearInterval(pwmMonitorInterval);
-        pwmMonitorInterval = null;
-      }
-    }
-    
-    function showCalibrationStep() {
-      console.log('Checking calibration step...');
-      fetch('/api/calibrate/status')
-        .then(r => r.json())
-        .then(data => {
-          console.log('Current calibration step:', data);
-          // Hide all steps first
-          document.getElementById('calStep1').style.display = 'none';
-          document.getElementById('calStep2').style.display = 'none';
-          document.getElementById('calStep3').style.display = 'none';
-          document.getElementById('calComplete').style.display = 'none';
-          
-          if (data.stepName === 'neutral') {
-            document.getElementById('calStep1').style.display = 'block';
-          } else if (data.stepName === 'throttle') {
-            console.log('Showing throttle step');
-            document.getElementById('calStep2').style.display = 'block';
-          } else if (data.stepName === 'brake') {
-            document.getElementById('calStep3').style.display = 'block';
-          } else if (data.stepName === 'complete') {
-            stopPWMMonitor();
-            fetch('/api/calibrate/results').then(r => r.json()).then(d => {
-              document.getElementById('calComplete').style.display = 'block';
-              document.getElementById('calNeutral').textContent = d.neutral;
-              document.getElementById('calThrottle').textContent = d.max;
-              document.getElementById('calBrake').textContent = d.min;
-              
-              setTimeout(() => {
-                document.getElementById('calibrationCard').style.display = 'none';
-                document.getElementById('calibrateBtn').disabled = false;
-                location.reload();
-              }, 2000);
-            });
-          } else {
-            stopPWMMonitor();
-            document.getElementById('calibrationCard').style.display = 'none';
-            document.getElementById('calibrateBtn').disabled = false;
-          }
-        })
-        .catch(err => {
-          console.error('Error checking calibration step:', err);
-        });
-    }
-    
-    function captureNeutral() {
-      fetch('/api/calibrate/capture/neutral')
-        .then(r => r.json())
-        .then(data => {
-          if (data.captured) {
-            document.getElementById('savedNeutral').textContent = data.value;
-            document.getElementById('savedNeutral2').textContent = data.value;
-            showCalibrationStep();
-          } else {
-            alert('Failed to capture neutral: ' + (data.error || 'Unknown error'));
-          }
-        })
-        .catch(err => {
-          alert('Error capturing neutral: ' + err);
-          console.error('Capture neutral error:', err);
-        });
-    }
-    
-    function captureThrottle() {
-      console.log('Capturing throttle...');
-      fetch('/api/calibrate/capture/throttle')
-        .then(r => {
-          console.log('Response status:', r.status);
-          return r.json();
-        })
-        .then(data => {
-          console.log('Response data:', data);
-          if (data.captured) {
-            document.getElementById('savedThrottle').textContent = data.value;
-            showCalibrationStep();
-          } else {
-            alert('Failed to capture throttle: ' + (data.error || 'Unknown error'));
-          }
-        })
-        .catch(err => {
-          alert('Error capturing throttle: ' + err);
-          console.error('Capture throttle error:', err);
-        });
-    }
-    
-    function captureBrake() {
-      fetch('/api/calibrate/capture/brake')
-        .then(r => r.json())
-        .then(data => {
-          if (data.captured) {
-            showCalibrationStep();
-          } else {
-            alert('Failed to capture brake: ' + (data.error || 'Unknown error'));
-          }
-        })
-        .catch(err => {
-          alert('Error capturing brake: ' + err);
-          console.error('Capture brake error:', err);
-        });
-    }
-    
-    function toggleEffectBtn(effect) {
-      const toggleMap = {
-        'backfire': 'toggleBackfire',
-        'brake': 'toggleBrake',
-        'idle': 'toggleIdle',
-        'rpm': 'toggleRpm'
-      };
-      const statusMap = {
-        'backfire': 'backfireStatus',
-        'brake': 'brakeStatus',
-        'idle': 'idleStatus',
-        'rpm': 'rpmStatus'
-      };
-      
-      const toggleBtn = document.getElementById(toggleMap[effect]);
-      const isActive = toggleBtn.classList.contains('active');
-      
-      fetch('/api/effects/' + effect + '/' + (isActive ? 'off' : 'on'))
-        .then(r => r.json())
-        .then(d => {
-          if (d.enabled) {
-            toggleBtn.classList.add('active');
-            document.getElementById(statusMap[effect]).classList.add('active');
-            document.getElementById(statusMap[effect]).textContent = 'ON';
-          } else {
-            toggleBtn.classList.remove('active');
-            document.getElementById(statusMap[effect]).classList.remove('active');
-            document.getElementById(statusMap[effect]).textContent = 'OFF';
-          }
-        });
-    }
-    
-    function updateThreshold(param, value) {
-      document.getElementById(param + 'Val').textContent = value;
-      fetch('/api/threshold?param=' + param + '&value=' + value);
-    }
-    
-    // Load settings and stats on page load
-    loadSettings();
-    updateStats();
-    setInterval(updateStats, 2000);
-  </script>
-</body>
-</html>)=====";
-    server.send(200, "text/html", html);
-  });
+  server.on("/", []() { serveAsset(ASSET_DASHBOARD_HTML); });
+  server.on("/common.css", []() { serveAsset(ASSET_COMMON_CSS); });
   
   // API endpoint - Status
   server.on("/api/status", []() {
-    // Calculate throttle position the same way as loop()
-    uint16_t current = pulseWidth;
-    int throttle;
-    if (current >= NEUTRAL_MIN && current <= NEUTRAL_MAX) {
-      throttle = 0;  // In neutral dead zone
-    } else if (current > NEUTRAL_MAX) {
-      throttle = map(current, NEUTRAL_MAX, MAX_PULSE, 0, 100);
-    } else {
-      throttle = map(current, MIN_PULSE, NEUTRAL_MIN, -100, 0);
-    }
-    throttle = constrain(throttle, -100, 100);
-    
-    unsigned long upSeconds = millis() / 1000;
-    unsigned long days = upSeconds / 86400;
-    unsigned long hours = (upSeconds % 86400) / 3600;
-    unsigned long mins = (upSeconds % 3600) / 60;
-    unsigned long secs = upSeconds % 60;
-    
-    String uptime = String(days) + "d " + String(hours) + "h " + String(mins) + "m " + String(secs) + "s";
-    
-    String json = "{";
-    json += "\"ip\":\"" + WiFi.localIP().toString() + "\",";
-    json += "\"uptime\":\"" + uptime + "\",";
-    json += "\"rssi\":" + String(WiFi.RSSI()) + ",";
-    json += "\"pwm\":" + String(current) + ",";
-    json += "\"throttle\":" + String(throttle) + ",";
-    json += "\"burst\":\"" + String(burstActive ? "YES" : "NO") + "\"";
-    json += "}";
-    
-    server.send(200, "application/json", json);
+    sendJson(200, writeStatusJson);
   });
   
   // API endpoint - Get current settings (toggles and thresholds)
   server.on("/api/settings", []() {
-    String json = "{";
-    json += "\"enableBackfire\":" + String(enableBackfire ? "true" : "false") + ",";
-    json += "\"enableBrakeCrackle\":" + String(enableBrakeCrackle ? "true" : "false") + ",";
-    json += "\"enableIdleBurble\":" + String(enableIdleBurble ? "true" : "false") + ",";
-    json += "\"enableRPMFlicker\":" + String(enableRPMFlicker ? "true" : "false") + ",";
-    json += "\"backfireThrottleMin\":" + String(backfireThrottleMin) + ",";
-    json += "\"backfireReleaseMax\":" + String(backfireReleaseMax) + ",";
-    json += "\"rpmFlickerThreshold\":" + String(rpmFlickerThreshold);
-    json += "}";
-    server.send(200, "application/json", json);
+    sendJson(200, writeSettingsJson);
   });
   
   // API endpoint - Test Backfire
   server.on("/api/test/backfire", []() {
     USBSerial.println("[Web] Manual backfire triggered");
-    burstActive = true;
-    burstCount = 5;
-    burstIntensity = 240;
-    lastEffectTime = millis();
-    server.send(200, "text/plain", "Backfire triggered");
+    if (!pushCommand(CMD_TRIGGER_BURST, EFFECT_BACKFIRE, 5, 240)) {
+      server.send_P(503, "text/plain", "Busy");
+      return;
+    }
+    server.send_P(200, "text/plain", "Backfire triggered");
   });
   
   // API endpoint - Test Crackle
   server.on("/api/test/crackle", []() {
     USBSerial.println("[Web] Manual crackle triggered");
-    burstActive = true;
-    burstCount = 6;
-    burstIntensity = 200;
-    lastEffectTime = millis();
-    server.send(200, "text/plain", "Crackle triggered");
+    if (!pushCommand(CMD_TRIGGER_BURST, EFFECT_BRAKE_CRACKLE, 6, 200)) {
+      server.send_P(503, "text/plain", "Busy");
+      return;
+    }
+    server.send_P(200, "text/plain", "Crackle triggered");
   });
   
   // API endpoint - Get Calibration Status
   server.on("/api/calibrate/status", []() {
-    String json = "{";
-    json += "\"step\":" + String((int)calibrationStep) + ",";
-    json += "\"stepName\":";
-    if (calibrationStep == CAL_IDLE) json += "\"idle\"";
-    else if (calibrationStep == CAL_NEUTRAL) json += "\"neutral\"";
-    else if (calibrationStep == CAL_THROTTLE) json += "\"throttle\"";
-    else if (calibrationStep == CAL_BRAKE) json += "\"brake\"";
-    else if (calibrationStep == CAL_COMPLETE) json += "\"complete\"";
-    json += "}";
-    server.send(200, "application/json", json);
+    sendJson(200, writeCalibrationStatusJson);
   });
   
   // API endpoint - Start Calibration
   server.on("/api/calibrate/start", []() {
-    USBSerial.println("\n[Cal] === STARTING MANUAL CALIBRATION ===");
-    USBSerial.println("[Cal] Step 1: Waiting for NEUTRAL capture...");
-    calibrationStep = CAL_NEUTRAL;
+    if (!pushCommand(CMD_CALIBRATE_START)) {
+      server.send_P(503, "application/json", "{\"status\":\"busy\"}");
+      return;
+    }
     
-    String json = "{\"status\":\"started\"}";
-    server.send(200, "application/json", json);
+    server.send_P(200, "application/json", "{\"status\":\"started\"}");
   });
   
   // API endpoint - Capture Neutral
   server.on("/api/calibrate/capture/neutral", []() {
-    if (calibrationStep == CAL_NEUTRAL) {
-      calibratedNeutral = pulseWidth;
-      NEUTRAL_PULSE = calibratedNeutral;
-      NEUTRAL_MIN = calibratedNeutral - 25;
-      NEUTRAL_MAX = calibratedNeutral + 25;
-      USBSerial.print("[Cal] ✓ Neutral captured: "); USBSerial.println(calibratedNeutral);
-      USBSerial.println("[Cal] Step 2: Waiting for THROTTLE capture...");
-      calibrationStep = CAL_THROTTLE;
+    if (publishedCalibrationStep() == CAL_NEUTRAL) {
+      uint16_t value = readCapture().width;
+      if (!pushCommand(CMD_CALIBRATE_CAPTURE, CAL_NEUTRAL, value)) {
+        server.send_P(503, "application/json", "{\"captured\":false,\"error\":\"Busy\"}");
+        return;
+      }
       
-      String json = "{\"captured\":true,\"value\":" + String(calibratedNeutral) + "}";
-      server.send(200, "application/json", json);
+      sendJson(200, [value](JsonWriter& json) { writeCaptureJson(json, value); });
     } else {
-      server.send(400, "application/json", "{\"captured\":false,\"error\":\"Wrong step\"}");
+      server.send_P(400, "application/json", "{\"captured\":false,\"error\":\"Wrong step\"}");
     }
   });
   
   // API endpoint - Capture Throttle
   server.on("/api/calibrate/capture/throttle", []() {
+    CalibrationStep step = publishedCalibrationStep();
     USBSerial.print("[Cal] Throttle capture request received. Current step: ");
-    USBSerial.println(calibrationStep);
+    USBSerial.println(step);
     
-    if (calibrationStep == CAL_THROTTLE) {
-      calibratedThrottle = pulseWidth;
-      MAX_PULSE = calibratedThrottle;
-      USBSerial.print("[Cal] ✓ Throttle captured: "); USBSerial.println(calibratedThrottle);
-      USBSerial.println("[Cal] Step 3: Waiting for BRAKE capture...");
-      calibrationStep = CAL_BRAKE;
+    if (step == CAL_THROTTLE) {
+      uint16_t value = readCapture().width;
+      if (!pushCommand(CMD_CALIBRATE_CAPTURE, CAL_THROTTLE, value)) {
+        server.send_P(503, "application/json", "{\"captured\":false,\"error\":\"Busy\"}");
+        return;
+      }
       
-      String json = "{\"captured\":true,\"value\":" + String(calibratedThrottle) + "}";
-      server.send(200, "application/json", json);
+      sendJson(200, [value](JsonWriter& json) { writeCaptureJson(json, value); });
     } else {
       USBSerial.println("[Cal] ERROR: Wrong step for throttle capture!");
-      String json = "{\"captured\":false,\"error\":\"Wrong step (expected CAL_THROTTLE)\"}";
-      server.send(400, "application/json", json);
+      server.send_P(400, "application/json", "{\"captured\":false,\"error\":\"Wrong step (expected CAL_THROTTLE)\"}");
     }
   });
   
   // API endpoint - Capture Brake
   server.on("/api/calibrate/capture/brake", []() {
-    if (calibrationStep == CAL_BRAKE) {
-      calibratedBrake = pulseWidth;
-      MIN_PULSE = calibratedBrake;
-      USBSerial.print("[Cal] ✓ Brake captured: "); USBSerial.println(calibratedBrake);
-      
-      USBSerial.println("\n[Cal] === CALIBRATION COMPLETE ===");
-      USBSerial.print("Neutral: "); USBSerial.print(NEUTRAL_PULSE);
-      USBSerial.print(" (range: "); USBSerial.print(NEUTRAL_MIN);
-      USBSerial.print("-"); USBSerial.print(NEUTRAL_MAX); USBSerial.println(")");
-      USBSerial.print("Full Throttle: "); USBSerial.println(MAX_PULSE);
-      USBSerial.print("Full Brake: "); USBSerial.println(MIN_PULSE);
-      
-      calibrationStep = CAL_COMPLETE;
-      
-      // Save calibration to EEPROM
-      saveSettings();
+    if (publishedCalibrationStep() == CAL_BRAKE) {
+      // Calibration is saved to EEPROM once the pipeline applies the capture
+      uint16_t value = readCapture().width;
+      if (!pushCommand(CMD_CALIBRATE_CAPTURE, CAL_BRAKE, value)) {
+        server.send_P(503, "application/json", "{\"captured\":false,\"error\":\"Busy\"}");
+        return;
+      }
       
-      String json = "{\"captured\":true,\"value\":" + String(calibratedBrake) + "}";
-      server.send(200, "application/json", json);
+      sendJson(200, [value](JsonWriter& json) { writeCaptureJson(json, value); });
     } else {
-      server.send(400, "application/json", "{\"captured\":false,\"error\":\"Wrong step\"}");
+      server.send_P(400, "application/json", "{\"captured\":false,\"error\":\"Wrong step\"}");
     }
   });
   
   // API endpoint - Get Calibration Results
   server.on("/api/calibrate/results", []() {
-    String json = "{";
-    json += "\"min\":" + String(MIN_PULSE) + ",";
-    json += "\"max\":" + String(MAX_PULSE) + ",";
-    json += "\"neutral\":" + String(NEUTRAL_PULSE) + ",";
-    json += "\"neutral_min\":" + String(NEUTRAL_MIN) + ",";
-    json += "\"neutral_max\":" + String(NEUTRAL_MAX);
-    json += "}";
-    server.send(200, "application/json", json);
+    sendJson(200, writeCalibrationResultsJson);
+  });
+  
+  // API endpoint - Live status (Server-Sent Events, one /api/status frame per event)
+  server.on("/api/events", []() {
+    if (!server.beginEventStream()) {
+      server.send_P(503, "text/plain", "Too many streams");
+    }
+  });
+  
+  // API endpoint - Event stream rate and delivery (?hz=1..50 sets the rate for all streams)
+  server.on("/api/events/rate", []() {
+    if (server.hasArg("hz")) {
+      eventRateHz = constrain(atoi(server.arg("hz")), 1, EVENT_RATE_MAX_HZ);
+    }
+    buildEventsJson();
+    sendResponse(200);
+  });
+  
+  // API endpoint - UDP capture stream (?host=a.b.c.d[&port=N] starts it, ?off stops it)
+  server.on("/api/udp", []() {
+    if (server.hasArg("off")) {
+      stopUdpStream();
+    } else if (server.hasArg("host")) {
+      IPAddress host;
+      int port = server.hasArg("port") ? atoi(server.arg("port")) : UDP_STREAM_DEFAULT_PORT;
+      if (!host.fromString(server.arg("host")) || port < 1 || port > 65535) {
+        server.send_P(400, "application/json", "{\"error\":\"Invalid host or port\"}");
+        return;
+      }
+      stopUdpStream();
+      if (!startUdpStream(host, port)) {
+        server.send_P(503, "application/json", "{\"error\":\"No socket available\"}");
+        return;
+      }
+    }
+    buildUdpJson();
+    sendResponse(200);
+  });
+  
+  // API endpoint - Per-stage timing (p50/p99/max in microseconds), ?reset=1 clears
+  server.on("/api/metrics", []() {
+    if (server.hasArg("reset")) {
+      // All or nothing: the frame stages are cleared by the loop, the rest here
+      if (!pushCommand(CMD_RESET_METRICS)) {
+        server.send_P(503, "application/json", "{\"error\":\"Busy\"}");
+        return;
+      }
+      memset(assetStats, 0, sizeof(assetStats));  // Owned by the server task
+      server.resetStats();
+    }
+    
+    buildMetricsJson();
+    sendResponse(200);
+  });
+  
+  // API endpoint - Frame deadline misses and watchdog reset report
+  server.on("/api/deadlines", []() {
+    buildDeadlinesJson();
+    sendResponse(200);
+  });
+  
+  // API endpoint - Heap, fragmentation and task stack high-water marks
+  server.on("/api/memory", []() {
+    buildMemoryJson();
+    sendResponse(200);
+  });
+  
+  // API endpoint - Idle power management
+  server.on("/api/power", []() {
+    buildPowerJson();
+    sendResponse(200);
   });
   
-  // API endpoints - Toggle Effects
-  server.on("/api/effects/backfire/on", []() { enableBackfire = true; saveSettings(); server.send(200, "application/json", "{\"enabled\":true}"); });
-  server.on("/api/effects/backfire/off", []() { enableBackfire = false; saveSettings(); server.send(200, "application/json", "{\"enabled\":false}"); });
-  server.on("/api/effects/brake/on", []() { enableBrakeCrackle = true; saveSettings(); server.send(200, "application/json", "{\"enabled\":true}"); });
-  server.on("/api/effects/brake/off", []() { enableBrakeCrackle = false; saveSettings(); server.send(200, "application/json", "{\"enabled\":false}"); });
-  server.on("/api/effects/idle/on", []() { enableIdleBurble = true; saveSettings(); server.send(200, "application/json", "{\"enabled\":true}"); });
-  server.on("/api/effects/idle/off", []() { enableIdleBurble = false; saveSettings(); server.send(200, "application/json", "{\"enabled\":false}"); });
-  server.on("/api/effects/rpm/on", []() { enableRPMFlicker = true; saveSettings(); server.send(200, "application/json", "{\"enabled\":true}"); });
-  server.on("/api/effects/rpm/off", []() { enableRPMFlicker = false; saveSettings(); server.send(200, "application/json", "{\"enabled\":false}"); });
+  // API endpoints - Radio-off mode (?idleOff=minutes sets the idle timeout, 0 = never)
+  server.on("/api/radio", []() {
+    if (server.hasArg("idleOff")) {
+      radioIdleOffMinutes = constrain(atoi(server.arg("idleOff")), 0, RADIO_IDLE_OFF_MAX_MIN);
+    }
+    buildRadioJson();
+    sendResponse(200);
+  });
+  server.on("/api/radio/off", []() {
+    if (!pushCommand(CMD_RADIO_OFF)) {
+      server.send_P(503, "text/plain", "Busy");
+      return;
+    }
+    server.send_P(200, "text/plain", "Radio turning off - hold full brake for 3 s to turn it back on");
+  });
+  
+  // API endpoints - Toggle Effects (applied and saved by the frame pipeline)
+  server.on("/api/effects/backfire/on", []() { sendEffectToggle(EFFECT_BACKFIRE, true); });
+  server.on("/api/effects/backfire/off", []() { sendEffectToggle(EFFECT_BACKFIRE, false); });
+  server.on("/api/effects/brake/on", []() { sendEffectToggle(EFFECT_BRAKE_CRACKLE, true); });
+  server.on("/api/effects/brake/off", []() { sendEffectToggle(EFFECT_BRAKE_CRACKLE, false); });
+  server.on("/api/effects/idle/on", []() { sendEffectToggle(EFFECT_IDLE_BURBLE, true); });
+  server.on("/api/effects/idle/off", []() { sendEffectToggle(EFFECT_IDLE_BURBLE, false); });
+  server.on("/api/effects/rpm/on", []() { sendEffectToggle(EFFECT_RPM_FLICKER, true); });
+  server.on("/api/effects/rpm/off", []() { sendEffectToggle(EFFECT_RPM_FLICKER, false); });
   
   // API endpoints - Threshold Adjustments (using query params)
   server.on("/api/threshold", []() { 
     if (server.hasArg("param") && server.hasArg("value")) {
-      String param = server.arg("param");
-      int value = server.arg("value").toInt();
+      // Both point into the request buffer; nothing is copied
+      const char* param = server.arg("param");
+      int value = atoi(server.arg("value"));
       
-      if (param == "backfireMin") {
-        backfireThrottleMin = value;
+      // Published as a new config snapshot; the loop notices and saves the settings
+      bool published = true;
+      if (strcmp(param, "backfireMin") == 0) {
+        published = updateConfig([value](RenderConfig& c) { c.backfireThrottleMin = value; });
         USBSerial.print("[Web] Backfire throttle min set to: "); USBSerial.println(value);
-      } else if (param == "backfireMax") {
-        backfireReleaseMax = value;
+      } else if (strcmp(param, "backfireMax") == 0) {
+        published = updateConfig([value](RenderConfig& c) { c.backfireReleaseMax = value; });
         USBSerial.print("[Web] Backfire release max set to: "); USBSerial.println(value);
-      } else if (param == "rpmThreshold") {
-        rpmFlickerThreshold = value;
+      } else if (strcmp(param, "rpmThreshold") == 0) {
+        published = updateConfig([value](RenderConfig& c) { c.rpmFlickerThreshold = value; });
         USBSerial.print("[Web] RPM flicker threshold set to: "); USBSerial.print(value); USBSerial.println("%");
       }
       
-      // Save settings after any threshold change
-      saveSettings();
+      if (!published) {
+        server.send_P(503, "text/plain", "Busy");
+        return;
+      }
     }
-    server.send(200, "text/plain", "OK");
+    server.send_P(200, "text/plain", "OK");
   });
 }
@@ -0,0 +1,98 @@
+#include "timer_wheel.h"
+
+#include <string.h>
+
+void timerInit(TimerWheel& w, WheelTimer* timers, uint8_t count, uint32_t nowMs) {
+  w.timers = timers;
+  w.count = count;
+  w.now = nowMs;
+  w.fired = 0;
+  memset(w.buckets, -1, sizeof(w.buckets));
+  for (uint8_t i = 0; i < w.count; i++) {
+    w.timers[i].armed = false;
+    w.timers[i].next = w.timers[i].prev = -1;
+  }
+}
+
+static void timerUnlink(TimerWheel& w, uint8_t id) {
+  WheelTimer& t = w.timers[id];
+  if (t.prev >= 0) w.timers[t.prev].next = t.next;
+  else w.buckets[t.due & (WHEEL_SLOTS - 1)] = t.next;
+  if (t.next >= 0) w.timers[t.next].prev = t.prev;
+  t.armed = false;
+}
+
+void timerSchedule(TimerWheel& w, uint8_t id, uint32_t nowMs, uint32_t delayMs) {
+  WheelTimer& t = w.timers[id];
+  if (t.armed) timerUnlink(w, id);
+  uint32_t due = nowMs + delayMs;
+  if ((int32_t)(due - w.now) <= 0) due = w.now + 1;
+
+  uint8_t bucket = due & (WHEEL_SLOTS - 1);
+  t.due = due;
+  t.prev = -1;
+  t.next = w.buckets[bucket];
+  if (t.next >= 0) w.timers[t.next].prev = id;
+  w.buckets[bucket] = id;
+  t.armed = true;
+}
+
+void timerStartPeriodic(TimerWheel& w, uint8_t id, uint32_t nowMs, uint32_t periodMs, uint32_t firstDelayMs) {
+  w.timers[id].periodMs = periodMs;
+  timerSchedule(w, id, nowMs, firstDelayMs);
+}
+
+void timerCancel(TimerWheel& w, uint8_t id) {
+  if (w.timers[id].armed) timerUnlink(w, id);
+}
+
+bool timerPending(const TimerWheel& w, uint8_t id) {
+  return w.timers[id].armed;
+}
+
+uint32_t timerAdvance(TimerWheel& w, uint32_t nowMs) {
+  int32_t behind = (int32_t)(nowMs - w.now);
+  if (behind <= 0) return 0;
+  bool catchUp = behind > WHEEL_SLOTS;
+  uint32_t steps = catchUp ? WHEEL_SLOTS : behind;
+  uint32_t start = w.now;
+  uint32_t fired = 0;
+
+  for (uint32_t i = 1; i <= steps; i++) {
+    uint32_t tick = catchUp ? nowMs : start + i;
+    uint8_t bucket = (start + i) & (WHEEL_SLOTS - 1);
+    w.now = tick;                        // Timers scheduled from a callback land after this tick
+    int8_t id = w.buckets[bucket];
+    while (id >= 0) {
+      WheelTimer& t = w.timers[id];
+      if ((int32_t)(t.due - tick) > 0) {    // A later turn
+        id = t.next;
+        continue;
+      }
+      timerUnlink(w, id);
+      if (t.periodMs > 0) {
+        uint32_t base = (int32_t)(t.due + t.periodMs - tick) > 0 ? t.due : tick;
+        timerSchedule(w, id, base, t.periodMs);
+      }
+      t.callback();
+      fired++;
+      id = w.buckets[bucket];            // The callback may have changed this bucket
+    }
+  }
+
+  w.now = nowMs;
+  w.fired += fired;
+  return fired;
+}
+
+bool timerNextDue(const TimerWheel& w, uint32_t& due) {
+  bool any = false;
+  for (uint8_t i = 0; i < w.count; i++) {
+    const WheelTimer& t = w.timers[i];
+    if (t.armed && (!any || (int32_t)(t.due - due) < 0)) {
+      due = t.due;
+      any = true;
+    }
+  }
+  return any;
+}
@@ -0,0 +1,52 @@
+// Timer wheel: fixed timer slots (no heap) hashed by due time into 1 ms buckets.
+// Scheduling and cancelling are O(1); advancing visits one bucket per elapsed
+// millisecond, at most one turn. The wheel keeps its own clock and makes no Arduino
+// calls, so tools/timer_wheel_test.cpp drives it with a virtual one on the host.
+#pragma once
+
+#include <stdint.h>
+
+#define WHEEL_SLOTS 64                   // Power of two: one turn = 64 ms
+
+typedef void (*TimerCallback)();
+
+struct WheelTimer {
+  TimerCallback callback;
+  uint32_t due;                          // Wheel time (ms) it fires at
+  uint32_t periodMs;                     // Re-armed this long after each firing (0 = one-shot)
+  int8_t next;                           // Bucket list links (timer index, -1 = none)
+  int8_t prev;
+  bool armed;
+};
+
+struct TimerWheel {
+  WheelTimer* timers;
+  uint8_t count;
+  uint32_t now;                          // Last time advanced to
+  uint32_t fired;                        // Callbacks run since init
+  int8_t buckets[WHEEL_SLOTS];           // First timer in each bucket
+};
+
+// Give the wheel its timer slots (callbacks and periods are set on the slots) and start
+// its clock at nowMs with nothing armed
+void timerInit(TimerWheel& w, WheelTimer* timers, uint8_t count, uint32_t nowMs);
+
+// Arm (or re-arm) a timer for nowMs + delayMs. A due time the wheel has already passed
+// fires on the next advance.
+void timerSchedule(TimerWheel& w, uint8_t id, uint32_t nowMs, uint32_t delayMs);
+
+// Fire every periodMs, the first time firstDelayMs from now. Stays phase-locked to the
+// first due time unless the wheel falls a whole period behind.
+void timerStartPeriodic(TimerWheel& w, uint8_t id, uint32_t nowMs, uint32_t periodMs, uint32_t firstDelayMs);
+
+void timerCancel(TimerWheel& w, uint8_t id);
+bool timerPending(const TimerWheel& w, uint8_t id);
+
+// Move the wheel clock to nowMs, running every callback that came due. Within a turn
+// they run in due-time order (one bucket per millisecond). After a gap longer than a turn
+// each bucket is visited once and fires everything due by nowMs, so they run in bucket
+// order instead. Callbacks may schedule or cancel any timer. Returns the number fired.
+uint32_t timerAdvance(TimerWheel& w, uint32_t nowMs);
+
+// Earliest armed due time; false when nothing is armed
+bool timerNextDue(const TimerWheel& w, uint32_t& due);
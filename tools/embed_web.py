@@ -0,0 +1,99 @@
+"""Gzip the web UI in web/ into src/web_assets.h.
+
+PlatformIO runs this before every build (extra_scripts = pre:tools/embed_web.py);
+it can also be run by hand: python tools/embed_web.py
+
+Each asset becomes a PROGMEM byte array holding the gzip stream (mtime 0, so the
+output only changes when the source does) and a strong ETag taken from its hash.
+The header is rewritten only when its content changes, so unchanged pages never
+trigger a rebuild of main.cpp.
+"""
+import gzip
+import hashlib
+import os
+
+try:
+    Import("env")  # noqa: F821 - provided by PlatformIO's SCons environment
+    ROOT = env.subst("$PROJECT_DIR")  # noqa: F821
+except NameError:
+    ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+WEB_DIR = os.path.join(ROOT, "web")
+OUTPUT = os.path.join(ROOT, "src", "web_assets.h")
+
+# Served files, in WEB_ASSETS order
+ASSETS = ["dashboard.html", "setup.html", "common.css"]
+
+CONTENT_TYPES = {
+    ".html": "text/html",
+    ".css": "text/css",
+    ".js": "application/javascript",
+}
+
+
+def symbol(name):
+    return name.upper().replace(".", "_").replace("-", "_")
+
+
+def c_bytes(data):
+    lines = []
+    for i in range(0, len(data), 16):
+        lines.append("  " + ", ".join("0x%02x" % b for b in data[i:i + 16]) + ",")
+    return "\n".join(lines)
+
+
+def generate():
+    out = [
+        "// Generated by tools/embed_web.py from web/ - do not edit",
+        "#pragma once",
+        "#include <Arduino.h>",
+        "",
+        "struct WebAsset {",
+        "  const char* name;",
+        "  const char* contentType;",
+        "  const uint8_t* gzip;                   // PROGMEM",
+        "  size_t gzipLength;",
+        "  size_t rawLength;",
+        "  const char* etag;                      // Quoted, strong",
+        "};",
+        "",
+        "enum WebAssetId : uint8_t {",
+    ]
+    out += ["  ASSET_%s," % symbol(name) for name in ASSETS]
+    out += ["  WEB_ASSET_COUNT", "};", ""]
+
+    entries = []
+    for name in ASSETS:
+        with open(os.path.join(WEB_DIR, name), "rb") as f:
+            raw = f.read()
+        packed = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = hashlib.sha256(packed).hexdigest()[:16]
+        content_type = CONTENT_TYPES[os.path.splitext(name)[1]]
+        print("[embed_web] %-16s %6d -> %5d bytes gzip (%d%%)"
+              % (name, len(raw), len(packed), 100 * len(packed) // len(raw)))
+
+        out.append("static const uint8_t %s_GZ[] PROGMEM = {" % symbol(name))
+        out.append(c_bytes(packed))
+        out.append("};")
+        out.append("")
+        entries.append('  { "%s", "%s", %s_GZ, %d, %d, "\\"%s\\"" },'
+                       % (name, content_type, symbol(name), len(packed), len(raw), etag))
+
+    out.append("static const WebAsset WEB_ASSETS[WEB_ASSET_COUNT] = {")
+    out += entries
+    out.append("};")
+    return "\n".join(out) + "\n"
+
+
+def main():
+    header = generate()
+    if os.path.exists(OUTPUT):
+        with open(OUTPUT) as f:
+            if f.read() == header:
+                return
+    with open(OUTPUT, "w") as f:
+        f.write(header)
+    print("[embed_web] Wrote " + os.path.relpath(OUTPUT, ROOT))
+
+
+main()
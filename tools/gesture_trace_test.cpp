@@ -0,0 +1,97 @@
+// Host test for the stick gesture recogniser (src/gesture.cpp).
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/gesture_trace_test.cpp src/gesture.cpp -o gesture_trace_test
+//   ./gesture_trace_test
+//
+// Each trace is replayed through a fresh recogniser and must produce exactly its expected
+// gestures: the three gestures, a fourth blip, a brake hold repeated, and the stick
+// movements that must not trigger anything (slow blips, blips straight after driving,
+// reverse engagement, mixed directions, throttle straight to brake).
+
+#include "gesture.h"
+
+#include <cstdio>
+
+// Hand-written stick traces: piecewise-constant throttle segments, sampled at the 50 Hz
+// receiver rate
+#define GESTURE_TRACE_STEP_MS 20
+
+struct TraceSegment {
+  int8_t throttle;
+  uint16_t ms;
+};
+
+struct GestureTrace {
+  const char* name;
+  const TraceSegment* segments;
+  uint8_t count;
+  Gesture expected;
+  uint8_t expectedCount;
+};
+
+#define BLIP(level) { (level) / 2, 20 }, { (level), 100 }, { (level) / 2, 20 }, { 0, 200 }
+static const TraceSegment TRACE_TRIPLE_BLIP[] = { { 0, 1200 }, BLIP(90), BLIP(90), BLIP(90), { 0, 800 } };
+static const TraceSegment TRACE_TRIPLE_BRAKE_BLIP[] = { { 0, 1200 }, BLIP(-90), BLIP(-90), BLIP(-90), { 0, 800 } };
+static const TraceSegment TRACE_FOUR_BLIPS[] = { { 0, 1200 }, BLIP(100), BLIP(100), BLIP(100), BLIP(100), { 0, 800 } };
+static const TraceSegment TRACE_BRAKE_HOLD[] = { { 0, 500 }, { -60, 40 }, { -100, 3200 }, { 0, 500 }, { -100, 3200 }, { 0, 500 } };
+static const TraceSegment TRACE_SLOW_BLIPS[] = { { 0, 1200 }, { 90, 600 }, { 0, 300 }, { 90, 600 }, { 0, 300 }, { 90, 600 }, { 0, 800 } };
+static const TraceSegment TRACE_BLIPS_WHILE_DRIVING[] = { { 80, 3000 }, { 0, 200 }, BLIP(90), BLIP(90), BLIP(90), { 0, 800 } };
+static const TraceSegment TRACE_REVERSE_ENGAGE[] = { { 0, 1200 }, { -100, 150 }, { 0, 150 }, { -100, 2000 }, { 0, 800 } };
+static const TraceSegment TRACE_MIXED_BLIPS[] = { { 0, 1200 }, BLIP(90), BLIP(-90), BLIP(90), { 0, 800 } };
+static const TraceSegment TRACE_THROUGH_NEUTRAL[] = { { 0, 1200 }, { 90, 100 }, { -90, 100 }, { 0, 200 }, BLIP(90), BLIP(90), { 0, 800 } };
+
+#define TRACE(name, segments, expected, count) { name, segments, sizeof(segments) / sizeof(segments[0]), expected, count }
+static const GestureTrace GESTURE_TRACES[] = {
+  TRACE("triple blip", TRACE_TRIPLE_BLIP, GESTURE_TRIPLE_BLIP, 1),
+  TRACE("triple brake blip", TRACE_TRIPLE_BRAKE_BLIP, GESTURE_TRIPLE_BRAKE_BLIP, 1),
+  TRACE("four blips", TRACE_FOUR_BLIPS, GESTURE_TRIPLE_BLIP, 1),
+  TRACE("brake hold twice", TRACE_BRAKE_HOLD, GESTURE_BRAKE_HOLD, 2),
+  TRACE("slow blips", TRACE_SLOW_BLIPS, GESTURE_NONE, 0),
+  TRACE("blips while driving", TRACE_BLIPS_WHILE_DRIVING, GESTURE_NONE, 0),
+  TRACE("reverse engage", TRACE_REVERSE_ENGAGE, GESTURE_NONE, 0),
+  TRACE("mixed blips", TRACE_MIXED_BLIPS, GESTURE_NONE, 0),
+  TRACE("throttle to brake", TRACE_THROUGH_NEUTRAL, GESTURE_NONE, 0),
+};
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("[%s] %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok) failures++;
+}
+
+int main() {
+  for (const GestureTrace& trace : GESTURE_TRACES) {
+    GestureState g = {};
+    uint32_t now = 0;
+    uint8_t seen = 0;
+    bool wrong = false;
+    for (uint8_t i = 0; i < trace.count; i++) {
+      for (uint16_t t = 0; t < trace.segments[i].ms; t += GESTURE_TRACE_STEP_MS, now += GESTURE_TRACE_STEP_MS) {
+        Gesture gesture = updateGesture(g, trace.segments[i].throttle, now);
+        if (gesture == GESTURE_NONE) continue;
+        seen++;
+        if (gesture != trace.expected) wrong = true;
+      }
+    }
+    if (wrong || seen != trace.expectedCount) {
+      printf("  expected %u x %s, got %u%s\n", trace.expectedCount, GESTURE_NAMES[trace.expected], seen,
+             wrong ? " (wrong gesture)" : "");
+    }
+    check(!wrong && seen == trace.expectedCount, trace.name);
+  }
+
+  // The clock wraps every 49.7 days; a hold that spans the wrap still fires once
+  {
+    GestureState g = {};
+    uint32_t now = 0xFFFFFFFFu - 1000;
+    uint8_t holds = 0;
+    for (int t = 0; t < 4000; t += GESTURE_TRACE_STEP_MS, now += GESTURE_TRACE_STEP_MS) {
+      if (updateGesture(g, -100, now) == GESTURE_BRAKE_HOLD) holds++;
+    }
+    check(holds == 1, "brake hold across the millis() wrap");
+  }
+
+  printf("%s\n", failures ? "FAILED" : "ALL PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,753 @@
+// Host load test for the firmware's HTTP server (src/http_server.cpp) over local sockets.
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/http_load_test.cpp src/http_server.cpp src/json_writer.cpp -lpthread -o http_load_test
+//   ./http_load_test
+//
+// While a slow-loris client, a client that never reads its response and an idle
+// keep-alive connection hold slots, fast keep-alive clients must still be answered
+// promptly. Also checks pipelining, Connection: close, form and raw POST bodies, and
+// that the server times out and evicts the misbehaving clients. Finally a fast and a
+// stalled event stream receive 50 Hz broadcasts while requests keep being answered.
+//
+// JSON bodies streamed with JsonWriter are compared with the printf-and-copy path they
+// replaced: handler time and heap allocations per request (counted by wrapping malloc on
+// the server thread; not available under a sanitizer), and 10,000 requests across the
+// routes must allocate nothing anywhere on the server thread. Then chunked output of a body
+// larger than the buffer through a device-sized send buffer to a client that is slow to
+// start reading, the 500 an HTTP/1.0 client gets for one, and a chunked body cut short
+// for a client that stops reading, with the wait hook (the firmware's watchdog feed)
+// called every slice of that wait. The status document here is a copy of the firmware's
+// writeStatusJson with fixed values, not the firmware function itself (that one reads
+// WiFi and the pipeline's telemetry, which only exist on the device).
+
+#include "http_server.h"
+#include "json_writer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#define TEST_PORT 18080
+#define EVENT_PERIOD_MS 20               // 50 Hz, the firmware's maximum stream rate
+
+static HttpServer server(TEST_PORT);
+static std::atomic<bool> running(true);
+
+static char page[18000];                 // Stand-in for the dashboard (served from "flash")
+static std::vector<char> bigBody(8 << 20);  // Larger than any socket buffer
+static char statusJson[1024];
+static int statusLength;
+
+static double nowMs() {
+  using namespace std::chrono;
+  return duration<double, std::milli>(steady_clock::now().time_since_epoch()).count();
+}
+
+// Heap allocations made while `counting` is set on the calling thread
+static thread_local bool counting = false;
+static std::atomic<uint64_t> allocations(0);
+static std::atomic<uint64_t> allocatedBytes(0);
+
+#if defined(__SANITIZE_ADDRESS__)
+#define ALLOCATIONS_COUNTED false
+#else
+#define ALLOCATIONS_COUNTED true
+extern "C" void* __libc_malloc(size_t size);
+extern "C" void* __libc_calloc(size_t count, size_t size);
+extern "C" void* __libc_realloc(void* p, size_t size);
+
+static void noteAllocation(size_t size) {
+  if (!counting) return;
+  allocations++;
+  allocatedBytes += size;
+}
+
+extern "C" void* malloc(size_t size) {
+  noteAllocation(size);
+  return __libc_malloc(size);
+}
+
+extern "C" void* calloc(size_t count, size_t size) {
+  noteAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+extern "C" void* realloc(void* p, size_t size) {
+  noteAllocation(size);
+  return __libc_realloc(p, size);
+}
+#endif
+
+// Time and allocations inside the benchmarked handlers
+struct HandlerCost {
+  uint32_t requests = 0;
+  double totalUs = 0;
+  uint64_t allocations = 0;
+  uint64_t bytes = 0;
+};
+static HandlerCost printfCost, writerCost;
+static std::atomic<bool> countServer(false);  // Count the whole server thread, not one handler
+
+// Stand-in for the firmware's watchdog feed: how often flushBody() calls the wait hook
+static std::atomic<double> lastWaitHookMs(0);
+static std::atomic<double> maxWaitHookGapMs(0);
+static std::atomic<uint32_t> waitHookCalls(0);
+
+static void waitHook() {
+  double now = nowMs();
+  if (lastWaitHookMs > 0 && now - lastWaitHookMs > maxWaitHookGapMs) maxWaitHookGapMs = now - lastWaitHookMs;
+  lastWaitHookMs = now;
+  waitHookCalls++;
+}
+
+template <typename Fn>
+static void measured(HandlerCost& cost, Fn handler) {
+  uint64_t allocationsBefore = allocations, bytesBefore = allocatedBytes;
+  counting = true;
+  auto start = std::chrono::steady_clock::now();
+  handler();
+  auto end = std::chrono::steady_clock::now();
+  counting = false;
+  cost.requests++;
+  cost.totalUs += std::chrono::duration<double, std::micro>(end - start).count();
+  cost.allocations += allocations - allocationsBefore;
+  cost.bytes += allocatedBytes - bytesBefore;
+}
+
+// The firmware's /api/status fields, with values that vary per request
+static uint32_t frameCounter = 0;
+
+static char responseBuffer[4096];
+static size_t responseLength;
+
+static void responseAppend(const char* fmt, ...) {
+  va_list args;
+  va_start(args, fmt);
+  int written = vsnprintf(responseBuffer + responseLength, sizeof(responseBuffer) - responseLength, fmt, args);
+  va_end(args);
+  if (written > 0) responseLength += written;
+}
+
+// Before: formatted into a shared buffer, then copied into the response
+static void statusPrintf() {
+  uint32_t frame = frameCounter++;
+  unsigned long upSeconds = frame / 100;
+  responseLength = 0;
+  responseAppend("{\"ip\":\"%u.%u.%u.%u\",", 192, 168, 1, 42);
+  responseAppend("\"uptime\":\"%lud %luh %lum %lus\",",
+                 upSeconds / 86400, (upSeconds % 86400) / 3600, (upSeconds % 3600) / 60, upSeconds % 60);
+  responseAppend("\"rssi\":%d,", -61);
+  responseAppend("\"pwm\":%u,", 1500 + frame % 500);
+  responseAppend("\"throttle\":%d,", (int)(frame % 200) - 100);
+  responseAppend("\"burst\":\"%s\",", frame & 1 ? "YES" : "NO");
+  responseAppend("\"frame\":%lu,", (unsigned long)frame);
+  responseAppend("\"led\":\"#%02X%02X%02X\",", 255, frame & 0xFF, 0);
+  responseAppend("\"detail\":\"%s\",", "full");
+  responseAppend("\"latencyUs\":%u,", 812);
+  responseAppend("\"frameUs\":%lu,\"workUs\":%lu}", 8333UL, 1200UL + frame % 100);
+  server.send(200, "application/json", responseBuffer, responseLength);
+}
+
+// After: the same document written in place in the connection's send buffer
+static bool flushJsonChunk(void*, size_t length) {
+  return server.flushBody(length);
+}
+
+template <typename Writer>
+static void sendJson(Writer write) {
+  size_t capacity;
+  char* body = server.beginBody(200, "application/json", &capacity);
+  if (body == nullptr) return;
+  JsonWriter json(body, capacity, flushJsonChunk);
+  write(json);
+  server.endBody(json.length(), !json.overflowed());
+}
+
+static void writeStatus(JsonWriter& json) {
+  uint32_t frame = frameCounter++;
+  unsigned long upSeconds = frame / 100;
+  json.beginObject();
+  json.key("ip").valuef("%u.%u.%u.%u", 192, 168, 1, 42);
+  json.key("uptime").valuef("%lud %luh %lum %lus",
+                            upSeconds / 86400, (upSeconds % 86400) / 3600, (upSeconds % 3600) / 60, upSeconds % 60);
+  json.field("rssi", -61);
+  json.field("pwm", 1500 + frame % 500);
+  json.field("throttle", (int)(frame % 200) - 100);
+  json.field("burst", frame & 1 ? "YES" : "NO");
+  json.field("frame", frame);
+  json.key("led").valuef("#%02X%02X%02X", 255, frame & 0xFF, 0);
+  json.field("detail", "full");
+  json.field("latencyUs", 812);
+  json.field("frameUs", 8333UL);
+  json.field("workUs", 1200UL + frame % 100);
+  json.endObject();
+}
+
+// A scan list far bigger than the send buffer, with names that need escaping
+static int networkCount = 0;
+
+static void writeNetworks(JsonWriter& json) {
+  char ssid[40];
+  json.beginObject();
+  json.field("scanning", false);
+  json.key("networks").beginArray();
+  for (int i = 0; i < networkCount; i++) {
+    snprintf(ssid, sizeof(ssid), "net \"%d\"\\\t%04d", i, i);
+    json.beginObject();
+    json.field("ssid", (const char*)ssid);
+    json.field("rssi", -40 - i % 50);
+    json.field("quality", (float)(i % 1000) / 10, 2);
+    json.endObject();
+  }
+  json.endArray();
+  json.endObject();
+}
+
+static void setupRoutes() {
+  memset(page, 'x', sizeof(page));
+  server.on("/", []() { server.send_P(200, "text/html", page, sizeof(page)); });
+  server.on("/big", []() { server.send_P(200, "application/octet-stream", bigBody.data(), bigBody.size()); });
+  statusLength = snprintf(statusJson, sizeof(statusJson), "{\"pulse\":%d,\"throttle\":%d,\"pad\":\"%0900d\"}", 1500, 0, 0);
+  server.on("/api/status", []() {
+    // Copied like the firmware's shared JSON buffer
+    server.send(200, "application/json", statusJson, statusLength);
+  });
+  server.on("/api/status-printf", []() {
+    if (server.hasArg("frame")) frameCounter = atoi(server.arg("frame"));
+    measured(printfCost, statusPrintf);
+  });
+  server.on("/api/status-writer", []() {
+    if (server.hasArg("frame")) frameCounter = atoi(server.arg("frame"));
+    measured(writerCost, []() { sendJson(writeStatus); });
+  });
+  server.on("/api/networks", []() {
+    networkCount = server.hasArg("count") ? atoi(server.arg("count")) : 10;
+    sendJson(writeNetworks);
+  });
+  server.on("/api/events", []() {
+    if (!server.beginEventStream()) server.send_P(503, "text/plain", "Too many streams");
+  });
+  server.on("/api/echo", HTTP_METHOD_POST, []() {
+    if (server.hasArg("value")) server.send(200, "text/plain", server.arg("value"));
+    else server.send(200, "text/plain", server.arg("plain"));
+  });
+}
+
+static int connectClient(int rcvBuf = 0) {
+  int fd = socket(AF_INET, SOCK_STREAM, 0);
+  if (rcvBuf > 0) setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvBuf, sizeof(rcvBuf));
+  struct timeval tv = { 5, 0 };
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+  int one = 1;
+  setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+  struct sockaddr_in addr;
+  memset(&addr, 0, sizeof(addr));
+  addr.sin_family = AF_INET;
+  addr.sin_port = htons(TEST_PORT);
+  addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+    close(fd);
+    return -1;
+  }
+  return fd;
+}
+
+// The host autotunes loopback send buffers to megabytes, so a stalled client would take
+// minutes to back up. Clamp the server's end of a client connection (found by its peer
+// port) to about lwIP's TCP_SND_BUF, as on the device.
+static void clampServerSendBuffer(int clientFd) {
+  struct sockaddr_in local;
+  socklen_t length = sizeof(local);
+  getsockname(clientFd, (struct sockaddr*)&local, &length);
+  for (int fd = 3; fd < 1024; fd++) {
+    struct sockaddr_in peer;
+    socklen_t peerLength = sizeof(peer);
+    if (fd == clientFd || getpeername(fd, (struct sockaddr*)&peer, &peerLength) < 0) continue;
+    if (peer.sin_port == local.sin_port) {
+      int size = 5744;
+      setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &size, sizeof(size));
+      return;
+    }
+  }
+}
+
+static bool sendAll(int fd, const std::string& data) {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    ssize_t n = send(fd, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n <= 0) return false;
+    sent += n;
+  }
+  return true;
+}
+
+// One response from a keep-alive stream; leftover bytes stay in `pending`
+struct Response {
+  int status = 0;
+  std::string body;
+  bool closeAfter = false;
+  bool chunked = false;
+};
+
+static bool fill(int fd, std::string& pending, size_t want) {
+  char buf[4096];
+  while (pending.size() < want) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    pending.append(buf, n);
+  }
+  return true;
+}
+
+static bool readChunked(int fd, std::string& pending, Response& out) {
+  for (;;) {
+    size_t lineEnd;
+    while ((lineEnd = pending.find("\r\n")) == std::string::npos) {
+      if (!fill(fd, pending, pending.size() + 1)) return false;
+    }
+    size_t size = strtoul(pending.c_str(), nullptr, 16);
+    pending.erase(0, lineEnd + 2);
+    if (!fill(fd, pending, size + 2) || pending.compare(size, 2, "\r\n") != 0) return false;
+    out.body.append(pending, 0, size);
+    pending.erase(0, size + 2);
+    if (size == 0) return true;
+  }
+}
+
+static bool readResponse(int fd, std::string& pending, Response& out) {
+  char buf[4096];
+  size_t headerEnd;
+  while ((headerEnd = pending.find("\r\n\r\n")) == std::string::npos) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    pending.append(buf, n);
+  }
+  std::string head = pending.substr(0, headerEnd);
+  out.status = atoi(head.c_str() + 9);
+  out.closeAfter = head.find("Connection: close") != std::string::npos;
+  out.chunked = head.find("Transfer-Encoding: chunked") != std::string::npos;
+  out.body.clear();
+  if (out.chunked) {
+    pending.erase(0, headerEnd + 4);
+    return readChunked(fd, pending, out);
+  }
+  size_t length = 0;
+  size_t at = head.find("Content-Length: ");
+  if (at != std::string::npos) length = strtoul(head.c_str() + at + 16, nullptr, 10);
+  pending.erase(0, headerEnd + 4);
+  while (pending.size() < length) {
+    ssize_t n = recv(fd, buf, sizeof(buf), 0);
+    if (n <= 0) return false;
+    pending.append(buf, n);
+  }
+  out.body = pending.substr(0, length);
+  pending.erase(0, length);
+  return true;
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("[%s] %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok) failures++;
+}
+
+static std::string post(const char* contentType, const std::string& body) {
+  return std::string("POST /api/echo HTTP/1.1\r\nContent-Type: ") + contentType +
+         "\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+}
+
+int main() {
+  setupRoutes();
+  server.onWait(waitHook);
+  server.begin();
+  std::thread serverThread([]() {
+    // Like the firmware's server task: poll, then one event serialised for all streams
+    static char event[3000];
+    uint32_t seq = 0;
+    double nextEvent = nowMs();
+    while (running) {
+      counting = countServer;
+      server.poll(5);
+      counting = false;
+      if (nowMs() >= nextEvent) {
+        nextEvent += EVENT_PERIOD_MS;
+        if (server.eventStreams() == 0) continue;
+        int n = snprintf(event, sizeof(event), "{\"seq\":%u,\"pad\":\"%02900d\"}", seq++, 0);
+        server.broadcastEvent(event, n);
+      }
+    }
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // Misbehaving clients take three of the slots
+  int stalled = connectClient(4096);
+  sendAll(stalled, "GET /big HTTP/1.1\r\nHost: x\r\n\r\n");  // ...and never reads
+  int idle = connectClient();                                // Opens and says nothing
+  std::atomic<bool> lorisDone(false);
+  std::atomic<int> lorisStatus(0);
+  double lorisStart = nowMs();
+  std::atomic<double> lorisEnd(0);
+  std::thread loris([&]() {
+    int fd = connectClient();
+    const char* request = "GET /api/status HTTP/1.1\r\nHost: x\r\nX-Pad: ";
+    for (const char* p = request; *p && !lorisDone; p++) {
+      send(fd, p, 1, MSG_NOSIGNAL);
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    while (!lorisDone) {
+      char c;
+      if (recv(fd, &c, 1, MSG_DONTWAIT) == 1) {
+        std::string pending(1, c);
+        Response r;
+        readResponse(fd, pending, r);
+        lorisStatus = r.status;
+        break;
+      }
+      if (send(fd, "a", 1, MSG_NOSIGNAL) <= 0) break;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    lorisEnd = nowMs();
+    close(fd);
+  });
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  // Fast keep-alive clients: one takes the last free slot, the next evicts the idle one
+  const int CLIENTS = 2;
+  const int REQUESTS = 500;
+  std::vector<double> latencies[CLIENTS];
+  std::atomic<int> bad(0);
+  std::vector<std::thread> clients;
+  double loadStart = nowMs();
+  for (int i = 0; i < CLIENTS; i++) {
+    clients.emplace_back([&, i]() {
+      int fd = connectClient();
+      std::string pending;
+      for (int r = 0; r < REQUESTS; r++) {
+        const char* path = (r % 10 == 0) ? "/" : "/api/status";
+        double start = nowMs();
+        Response resp;
+        if (fd < 0 || !sendAll(fd, std::string("GET ") + path + " HTTP/1.1\r\nHost: x\r\n\r\n") ||
+            !readResponse(fd, pending, resp) || resp.status != 200 ||
+            resp.body.size() != (r % 10 == 0 ? sizeof(page) : (size_t)statusLength)) {
+          bad++;
+          break;
+        }
+        latencies[i].push_back(nowMs() - start);
+      }
+      if (fd >= 0) close(fd);
+    });
+  }
+  for (std::thread& t : clients) t.join();
+  double loadMs = nowMs() - loadStart;
+
+  std::vector<double> all;
+  for (auto& l : latencies) all.insert(all.end(), l.begin(), l.end());
+  std::sort(all.begin(), all.end());
+  double p50 = all.empty() ? 0 : all[all.size() / 2];
+  double p99 = all.empty() ? 0 : all[all.size() * 99 / 100];
+  double worst = all.empty() ? 0 : all.back();
+  printf("Keep-alive load: %zu requests in %.0f ms (%.0f req/s), latency p50 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+         all.size(), loadMs, all.size() * 1000.0 / loadMs, p50, p99, worst);
+  check(bad == 0 && all.size() == CLIENTS * REQUESTS, "every keep-alive request answered in full");
+  check(worst < 100, "no request waited on the slow clients (max latency < 100 ms)");
+  check(server.stats().evicted >= 1, "idle connection evicted to admit a client");
+
+  // Pipelining, Connection: close and request bodies
+  {
+    int fd = connectClient();
+    sendAll(fd, "GET /api/status HTTP/1.1\r\n\r\nGET / HTTP/1.1\r\n\r\nGET /api/status HTTP/1.1\r\nConnection: close\r\n\r\n");
+    std::string pending;
+    Response a, b, c;
+    bool ok = readResponse(fd, pending, a) && readResponse(fd, pending, b) && readResponse(fd, pending, c);
+    check(ok && a.status == 200 && b.body.size() == sizeof(page) && c.closeAfter, "three pipelined requests, last one closes");
+    close(fd);
+  }
+  {
+    int fd = connectClient();
+    sendAll(fd, post("application/x-www-form-urlencoded", "value=hello+w%6Frld"));
+    std::string pending;
+    Response r;
+    bool ok = readResponse(fd, pending, r);
+    sendAll(fd, post("application/json", "{\"ssid\":\"ab\"}"));
+    Response j;
+    ok = ok && readResponse(fd, pending, j);
+    check(ok && r.body == "hello world" && j.body == "{\"ssid\":\"ab\"}", "form and raw POST bodies");
+    close(fd);
+  }
+  {
+    int fd = connectClient();
+    std::string huge = "GET /api/status HTTP/1.1\r\nX-Big: " + std::string(2000, 'a') + "\r\n\r\n";
+    sendAll(fd, huge);
+    std::string pending;
+    Response r;
+    check(readResponse(fd, pending, r) && r.status == 431, "oversized request rejected with 431");
+    close(fd);
+  }
+  {
+    double start = nowMs();
+    int ok = 0;
+    for (int i = 0; i < 200; i++) {
+      int fd = connectClient();
+      std::string pending;
+      Response r;
+      if (fd >= 0 && sendAll(fd, "GET /api/status HTTP/1.0\r\n\r\n") && readResponse(fd, pending, r) && r.status == 200) ok++;
+      if (fd >= 0) close(fd);
+    }
+    printf("Short connections: 200 in %.0f ms\n", nowMs() - start);
+    check(ok == 200, "HTTP/1.0 one-request connections");
+  }
+
+  // The misbehaving clients are cut off by the server's timeouts
+  std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_WRITE_TIMEOUT_MS + 500));
+  lorisDone = true;
+  loris.join();
+  printf("Slow loris answered %d after %.0f ms\n", lorisStatus.load(), lorisEnd.load() - lorisStart);
+  check(lorisStatus == 408, "slow-loris request timed out with 408");
+  check(server.stats().timeouts >= 2, "stalled reader and slow loris both timed out");
+  close(stalled);
+  close(idle);
+
+  // Event streams: a fast reader, a reader that stalls, and one stream too many
+  {
+    const char* open = "GET /api/events HTTP/1.1\r\nAccept: text/event-stream\r\n\r\n";
+    int fast = connectClient();
+    int slow = connectClient(4096);
+    int third = connectClient();
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Accepted by now
+    clampServerSendBuffer(slow);
+    sendAll(fast, open);
+    sendAll(slow, open);
+    sendAll(third, open);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    int extra = connectClient();
+    sendAll(extra, open);
+    std::string pending;
+    Response r;
+    check(readResponse(extra, pending, r) && r.status == 503, "stream beyond the limit refused with 503");
+    close(extra);
+    close(third);
+
+    // Read the fast stream for 2 s while a normal client polls alongside it
+    std::atomic<int> pollBad(0);
+    std::atomic<double> pollWorst(0);
+    std::thread poller([&]() {
+      int fd = connectClient();
+      std::string pending;
+      for (int i = 0; i < 100; i++) {
+        double start = nowMs();
+        Response resp;
+        if (!sendAll(fd, "GET /api/status HTTP/1.1\r\n\r\n") || !readResponse(fd, pending, resp) || resp.status != 200) {
+          pollBad++;
+          break;
+        }
+        pollWorst = std::max(pollWorst.load(), nowMs() - start);
+        std::this_thread::sleep_for(std::chrono::milliseconds(15));
+      }
+      close(fd);
+    });
+    std::string stream;
+    char buf[4096];
+    int events = 0;
+    long lastSeq = -1;
+    bool ordered = true;
+    double lastEvent = 0, worstGap = 0;
+    double end = nowMs() + 2000;
+    while (nowMs() < end) {
+      ssize_t n = recv(fast, buf, sizeof(buf), 0);
+      if (n <= 0) break;
+      stream.append(buf, n);
+      size_t at;
+      while ((at = stream.find("data: ")) != std::string::npos) {
+        size_t eventEnd = stream.find("\n\n", at);
+        if (eventEnd == std::string::npos) break;
+        long seq = strtol(stream.c_str() + at + 13, nullptr, 10);
+        ordered = ordered && seq > lastSeq;
+        lastSeq = seq;
+        if (events++ > 0) worstGap = std::max(worstGap, nowMs() - lastEvent);
+        lastEvent = nowMs();
+        stream.erase(0, eventEnd + 2);
+      }
+    }
+    poller.join();
+    printf("Event stream: %d events in 2 s, worst gap %.1f ms; polls alongside worst %.2f ms; %u sent, %u dropped\n",
+           events, worstGap, pollWorst.load(), server.stats().eventsSent, server.stats().eventsDropped);
+    check(events >= 80 && ordered && worstGap < 100, "fast stream receives every 50 Hz event in order");
+    check(pollBad == 0 && pollWorst < 100, "requests answered while streams are open");
+    check(server.stats().eventsDropped > 0, "stalled stream skips events instead of queueing them");
+
+    uint32_t timeoutsBefore = server.stats().timeouts;
+    std::this_thread::sleep_for(std::chrono::milliseconds(HTTP_WRITE_TIMEOUT_MS + 500));
+    check(server.stats().timeouts > timeoutsBefore, "stalled stream dropped by the write timeout");
+    close(fast);
+    close(slow);
+  }
+
+  // Streamed JSON against the printf-and-copy path it replaced
+  {
+    int fd = connectClient();
+    std::string pending;
+    Response a, b;
+    bool same = true;
+    for (int frame = 0; frame < 300 && same; frame += 7) {
+      std::string query = "?frame=" + std::to_string(frame * 1000003) + " HTTP/1.1\r\n\r\n";
+      same = sendAll(fd, "GET /api/status-printf" + query) && readResponse(fd, pending, a) &&
+             sendAll(fd, "GET /api/status-writer" + query) && readResponse(fd, pending, b) &&
+             a.status == 200 && b.status == 200 && a.body == b.body && !b.chunked;
+    }
+    check(same, "streamed status is byte-identical to the printf one");
+
+    printfCost = HandlerCost();
+    writerCost = HandlerCost();
+    const int ROUNDS = 5000;
+    int ok = 0;
+    for (int i = 0; i < ROUNDS; i++) {
+      if (sendAll(fd, "GET /api/status-printf HTTP/1.1\r\n\r\n") && readResponse(fd, pending, a) && a.status == 200 &&
+          sendAll(fd, "GET /api/status-writer HTTP/1.1\r\n\r\n") && readResponse(fd, pending, b) && b.status == 200) ok++;
+    }
+    close(fd);
+    for (const HandlerCost* cost : { &printfCost, &writerCost }) {
+      printf("Status %s: %u requests, %.3f us/request in the handler, %.2f allocations (%.1f bytes) per request%s\n",
+             cost == &printfCost ? "printf + copy" : "streamed     ", cost->requests, cost->totalUs / cost->requests,
+             (double)cost->allocations / cost->requests, (double)cost->bytes / cost->requests,
+             ALLOCATIONS_COUNTED ? "" : " (not counted under a sanitizer)");
+    }
+    check(ok == ROUNDS, "benchmark requests answered");
+    HandlerCost probe;
+    measured(probe, []() {
+      void* volatile p = malloc(64);
+      free(p);
+    });
+    check(!ALLOCATIONS_COUNTED || probe.allocations == 1, "allocation counter sees a malloc");
+    check(writerCost.allocations == 0, "streamed responses allocate nothing");
+  }
+  {
+    // Heap soak: 10,000 keep-alive requests across the routes, every allocation on the
+    // server thread counted (accept, parse, dispatch, handler, send)
+    const int SOAK_REQUESTS = 10000;
+    const std::string requests[] = {
+      "GET /api/status HTTP/1.1\r\n\r\n",
+      "GET /api/status-writer?frame=7 HTTP/1.1\r\n\r\n",
+      "GET /api/networks HTTP/1.1\r\n\r\n",
+      "GET / HTTP/1.1\r\n\r\n",
+      post("application/x-www-form-urlencoded", "value=soak"),
+      "GET /missing HTTP/1.1\r\n\r\n",
+    };
+    const int expected[] = { 200, 200, 200, 200, 200, 404 };
+    const int kinds = sizeof(expected) / sizeof(expected[0]);
+    uint64_t allocationsBefore = allocations, bytesBefore = allocatedBytes;
+    countServer = true;
+    int fd = connectClient();
+    std::string pending;
+    Response r;
+    int ok = 0;
+    for (int i = 0; i < SOAK_REQUESTS; i++) {
+      if (sendAll(fd, requests[i % kinds]) && readResponse(fd, pending, r) && r.status == expected[i % kinds]) ok++;
+    }
+    close(fd);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));  // Server sees the close
+    countServer = false;
+    uint64_t soakAllocations = allocations - allocationsBefore;
+    printf("Heap soak: %d requests, %llu allocations (%llu bytes) on the server thread%s\n", SOAK_REQUESTS,
+           (unsigned long long)soakAllocations, (unsigned long long)(allocatedBytes - bytesBefore),
+           ALLOCATIONS_COUNTED ? "" : " (not counted under a sanitizer)");
+    check(ok == SOAK_REQUESTS, "heap soak requests answered");
+    check(soakAllocations == 0, "10,000 requests through the server allocate nothing");
+  }
+  {
+    // 2,000 networks is ~120 KB: many chunks, each sent from the handler through a send
+    // buffer the size of lwIP's, to a client that only starts reading after 300 ms
+    int fd = connectClient(4096);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    clampServerSendBuffer(fd);
+    std::string pending;
+    Response small, big, after;
+    bool ok = sendAll(fd, "GET /api/networks?count=3 HTTP/1.1\r\n\r\n") && readResponse(fd, pending, small) &&
+              sendAll(fd, "GET /api/networks?count=2000 HTTP/1.1\r\n\r\n");
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    ok = ok && readResponse(fd, pending, big) &&
+         sendAll(fd, "GET /api/networks?count=1 HTTP/1.1\r\n\r\n") && readResponse(fd, pending, after);
+    check(ok && !small.chunked && small.body == "{\"scanning\":false,\"networks\":["
+                                                  "{\"ssid\":\"net \\\"0\\\"\\\\\\u00090000\",\"rssi\":-40,\"quality\":0.00},"
+                                                  "{\"ssid\":\"net \\\"1\\\"\\\\\\u00090001\",\"rssi\":-41,\"quality\":0.10},"
+                                                  "{\"ssid\":\"net \\\"2\\\"\\\\\\u00090002\",\"rssi\":-42,\"quality\":0.20}]}",
+          "small body sent whole with Content-Length and escaped");
+    size_t entries = 0;
+    for (size_t at = 0; (at = big.body.find("{\"ssid\"", at)) != std::string::npos; at++) entries++;
+    bool ends = big.body.size() > 2 && big.body.compare(big.body.size() - 2, 2, "]}") == 0;
+    printf("Chunked body: %zu bytes, %zu entries\n", big.body.size(), entries);
+    check(ok && big.chunked && entries == 2000 && ends && big.body.find("\"quality\":99.90}") != std::string::npos,
+          "large body streamed as chunks through a small send buffer, complete and in order");
+    check(ok && after.status == 200 && !after.chunked, "connection reused after a chunked response");
+    close(fd);
+  }
+  {
+    int fd = connectClient();
+    std::string pending;
+    Response r;
+    check(sendAll(fd, "GET /api/networks?count=2000 HTTP/1.0\r\n\r\n") && readResponse(fd, pending, r) && r.status == 500,
+          "HTTP/1.0 client gets 500 for a body that needs chunks");
+    close(fd);
+  }
+  {
+    // The client stops reading: after the write timeout the handler gives up
+    int fd = connectClient(4096);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    clampServerSendBuffer(fd);
+    uint32_t truncatedBefore = server.stats().truncated;
+    lastWaitHookMs = 0;
+    maxWaitHookGapMs = 0;
+    waitHookCalls = 0;
+    double start = nowMs();
+    sendAll(fd, "GET /api/networks?count=50000 HTTP/1.1\r\n\r\n");
+    while (server.stats().truncated == truncatedBefore && nowMs() - start < HTTP_WRITE_TIMEOUT_MS * 4) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    }
+    double stalledMs = nowMs() - start;
+    printf("Stalled chunked reader cut short after %.0f ms\n", stalledMs);
+    check(server.stats().truncated > truncatedBefore && stalledMs >= HTTP_WRITE_TIMEOUT_MS - 100,
+          "stalled chunked body cut short after the write timeout");
+    printf("Wait hook: %u calls while stalled, longest gap %.0f ms\n", (unsigned)waitHookCalls, (double)maxWaitHookGapMs);
+    check(waitHookCalls >= HTTP_WRITE_TIMEOUT_MS / HTTP_WAIT_SLICE_MS && maxWaitHookGapMs < HTTP_WAIT_SLICE_MS + 100,
+          "wait hook called every slice while the handler waits (watchdog fed)");
+    int other = connectClient();
+    std::string pending;
+    Response r;
+    bool answered = sendAll(other, "GET /api/status-writer HTTP/1.1\r\n\r\n") && readResponse(other, pending, r);
+    close(other);
+    check(answered && r.status == 200, "server answers again once the stalled body is given up");
+
+    // Reading it now: the chunks queued so far, then the close (no terminating chunk)
+    std::string body;
+    char buf[4096];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) body.append(buf, n);
+    check(n == 0 && body.size() < 200000 && body.find("\r\n0\r\n\r\n") == std::string::npos,
+          "truncated body closes without the last chunk");
+    close(fd);
+  }
+
+  const HttpStats& s = server.stats();
+  printf("Server: %u accepted, %u requests (%u keep-alive reuses), %u evicted, %u timeouts, %u rejected, peak %u open, "
+         "%u chunked (%u truncated), handler avg %.1f us max %u us\n",
+         s.accepted, s.requests, s.keepAliveReuses, s.evicted, s.timeouts, s.rejected, s.peakActive, s.chunked, s.truncated,
+         s.requests ? (double)s.handlerUsTotal / s.requests : 0.0, s.handlerUsMax);
+
+  running = false;
+  serverThread.join();
+  printf("%s\n", failures ? "FAILED" : "ALL PASSED");
+  return failures ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+// Host test for the timer wheel (src/timer_wheel.cpp).
+//
+//   g++ -std=gnu++17 -O2 -Isrc tools/timer_wheel_test.cpp src/timer_wheel.cpp -o timer_wheel_test
+//   ./timer_wheel_test
+//
+// Drives a wheel with a virtual clock through the cases the firmware relies on: exact due
+// times, delays longer than a turn, periodic timers, cancel, re-arm, a clock jump, and a
+// zero delay scheduled from inside a callback. The clock starts just before the 32-bit
+// wrap, so every comparison crosses it.
+
+#include "timer_wheel.h"
+
+#include <cstdio>
+#include <cstring>
+
+#define TEST_TIMERS 4
+#define TEST_MAX_FIRINGS 8
+
+static WheelTimer testTimerSlots[TEST_TIMERS];
+static TimerWheel wheel;
+static uint32_t firedAt[TEST_TIMERS][TEST_MAX_FIRINGS];
+static uint8_t firedCount[TEST_TIMERS];
+
+static void record(uint8_t id) {
+  if (firedCount[id] < TEST_MAX_FIRINGS) firedAt[id][firedCount[id]] = wheel.now;
+  firedCount[id]++;
+}
+static void timer0() { record(0); }
+static void timer1() { record(1); }
+static void timer2() { record(2); }
+static void timer3() {
+  record(3);
+  if (firedCount[3] == 1) timerSchedule(wheel, 3, wheel.now, 0);
+}
+
+static int failures = 0;
+
+static void check(bool ok, const char* what) {
+  printf("[%s] %s\n", ok ? "PASS" : "FAIL", what);
+  if (!ok) failures++;
+}
+
+// Fired count times, the first at firstAt
+static bool fired(uint8_t id, uint8_t count, uint32_t firstAt) {
+  bool ok = firedCount[id] == count && (count == 0 || firedAt[id][0] == firstAt);
+  if (!ok) {
+    printf("  timer %u fired %u times, first at %lu\n", id, firedCount[id],
+           firedCount[id] ? (unsigned long)firedAt[id][0] : 0UL);
+  }
+  return ok;
+}
+
+int main() {
+  const TimerCallback callbacks[TEST_TIMERS] = { timer0, timer1, timer2, timer3 };
+  for (uint8_t i = 0; i < TEST_TIMERS; i++) {
+    testTimerSlots[i].callback = callbacks[i];
+    testTimerSlots[i].periodMs = 0;
+  }
+  memset(firedCount, 0, sizeof(firedCount));
+
+  uint32_t t0 = 0xFFFFFF00UL;
+  timerInit(wheel, testTimerSlots, TEST_TIMERS, t0);
+  timerSchedule(wheel, 0, t0, 5);
+  timerSchedule(wheel, 1, t0, 300);                      // Several turns out
+  timerStartPeriodic(wheel, 2, t0, 100, 100);
+  uint32_t due = 0;
+  check(timerNextDue(wheel, due) && due == t0 + 5, "next due is the earliest timer");
+  for (uint32_t ms = 1; ms <= 250; ms++) timerAdvance(wheel, t0 + ms);  // 1 ms frames
+
+  check(fired(0, 1, t0 + 5), "exact due time");
+  check(fired(1, 0, 0) && timerPending(wheel, 1), "delay of several turns not yet due");
+  check(fired(2, 2, t0 + 100) && firedAt[2][1] == t0 + 200, "periodic timer");
+
+  timerCancel(wheel, 2);
+  timerSchedule(wheel, 1, t0 + 250, 20);                 // Re-arm earlier
+  timerAdvance(wheel, t0 + 280);                         // One 30 ms step
+  check(fired(1, 1, t0 + 270), "re-arm earlier");
+  check(fired(2, 2, t0 + 100) && !timerPending(wheel, 2), "cancelled periodic timer");
+
+  timerSchedule(wheel, 0, t0 + 280, 10);
+  timerAdvance(wheel, t0 + 1280);                        // 1 s stall: caught up in one pass
+  check(firedCount[0] == 2 && firedAt[0][1] == t0 + 1280, "one second clock jump");
+
+  timerSchedule(wheel, 3, t0 + 1280, 0);                 // Zero delay: next advance, then again
+  timerAdvance(wheel, t0 + 1281);
+  timerAdvance(wheel, t0 + 1282);
+  check(fired(3, 2, t0 + 1281) && firedAt[3][1] == t0 + 1282, "zero delay from a callback");
+
+  check(!timerNextDue(wheel, due) && wheel.fired == 7, "nothing left armed");
+
+  printf("%s\n", failures ? "FAILED" : "ALL PASSED");
+  return failures ? 1 : 0;
+}
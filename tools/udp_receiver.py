@@ -0,0 +1,109 @@
+"""Receive the firmware's UDP telemetry stream and write it as CSV.
+
+Start the stream from the device, then run the receiver on the same host:
+
+    curl "http://<device-ip>/api/udp?host=<this-host-ip>&port=4210"
+    python tools/udp_receiver.py --port 4210 --output session.csv
+
+Each datagram holds a 16-byte header and up to 40 packed 30-byte frame records (see
+UDP TELEMETRY STREAM in src/main.cpp). One CSV row is written per frame. Lost datagrams
+(sequence gaps) and records the device had to drop are reported on stderr when the
+receiver stops (Ctrl-C, --seconds or --frames).
+"""
+import argparse
+import csv
+import socket
+import struct
+import sys
+import time
+
+MAGIC = 0x4C544641  # "AFTL"
+VERSION = 1
+HEADER = struct.Struct("<IHHII")
+RECORD = struct.Struct("<IIHbBBBBB3BBHII")
+
+FRAME_MODES = ["steady", "fast", "idle"]
+CALIBRATION_STEPS = ["idle", "neutral", "throttle", "brake", "complete"]
+EFFECTS = ["backfire", "brakeCrackle", "idleBurble", "rpmFlicker"]  # EffectId bit order
+DETAIL_TIERS = ["full", "reduced", "minimal"]
+
+COLUMNS = [
+    "frame", "frame_start_us", "pulse_us", "throttle", "capture_flags", "frame_mode",
+    "calibration_step", "effects", "detail_tier", "led", "burst_count", "latency_us",
+    "frame_dt_us", "work_us",
+]
+
+
+def name(names, index):
+    return names[index] if index < len(names) else str(index)
+
+
+def decode_record(data, offset):
+    (frame, start_us, pulse, throttle, flags, mode, step, effects, tier,
+     r, g, b, burst, latency, dt, work) = RECORD.unpack_from(data, offset)
+    active = "+".join(e for bit, e in enumerate(EFFECTS) if effects & (1 << bit))
+    return [
+        frame, start_us, pulse, throttle, flags, name(FRAME_MODES, mode),
+        name(CALIBRATION_STEPS, step), active, name(DETAIL_TIERS, tier),
+        "#%02X%02X%02X" % (r, g, b), burst, latency, dt, work,
+    ]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--port", type=int, default=4210)
+    parser.add_argument("--bind", default="0.0.0.0", help="local address to listen on")
+    parser.add_argument("--output", help="CSV file (default: stdout)")
+    parser.add_argument("--seconds", type=float, help="stop after this long")
+    parser.add_argument("--frames", type=int, help="stop after this many frames")
+    args = parser.parse_args()
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.bind, args.port))
+    sock.settimeout(0.5)
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    writer = csv.writer(out)
+    writer.writerow(COLUMNS)
+    print("[udp_receiver] Listening on %s:%d" % (args.bind, args.port), file=sys.stderr)
+
+    datagrams = frames = lost = bad = 0
+    device_dropped = 0
+    expected = None
+    deadline = time.monotonic() + args.seconds if args.seconds else None
+    try:
+        while deadline is None or time.monotonic() < deadline:
+            try:
+                data, _ = sock.recvfrom(2048)
+            except socket.timeout:
+                continue
+            if len(data) < HEADER.size:
+                bad += 1
+                continue
+            magic, version, count, sequence, dropped = HEADER.unpack_from(data)
+            if magic != MAGIC or version != VERSION or len(data) != HEADER.size + count * RECORD.size:
+                bad += 1
+                continue
+            if expected is not None and sequence != expected:
+                if sequence > expected:
+                    lost += sequence - expected
+                else:
+                    print("[udp_receiver] Stream restarted", file=sys.stderr)
+            expected = sequence + 1
+            device_dropped = dropped
+            datagrams += 1
+            for i in range(count):
+                writer.writerow(decode_record(data, HEADER.size + i * RECORD.size))
+            frames += count
+            if args.frames and frames >= args.frames:
+                break
+    except KeyboardInterrupt:
+        pass
+    finally:
+        if out is not sys.stdout:
+            out.close()
+        print("[udp_receiver] %d frames in %d datagrams; %d datagrams lost, %d records dropped on the device, "
+              "%d malformed" % (frames, datagrams, lost, device_dropped, bad), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()